@@ -0,0 +1,354 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#include "gef.hpp"
+
+// byte_buffer appends against std::vector, the portable codec, inline storage and the SPSC ring
+
+namespace {
+
+	constexpr size_t message_size = 64;
+
+	constexpr std::array<byte, message_size> message_payload() {
+		std::array<byte, message_size> payload{};
+
+		for (size_t i = 0; i < message_size; ++i) {
+			payload[i] = static_cast<byte>(i);
+		}
+
+		return payload;
+	}
+
+	constexpr std::array<byte, message_size> payload = message_payload();
+
+	// `range(0)` small messages (u32 id, u16 length, payload) into a buffer grown from empty
+	void small_messages_byte_buffer(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		for (auto _ : state) {
+			byte_buffer buffer;
+
+			for (size_t i = 0; i < count; ++i) {
+				buffer.construct_back<u32>(static_cast<u32>(i));
+				buffer.construct_back<u16>(static_cast<u16>(message_size));
+				buffer.copy_back(payload.data(), payload.size());
+			}
+
+			benchmark::ClobberMemory();
+		}
+
+		state.SetBytesProcessed(state.iterations() * count * (message_size + 6));
+	}
+
+	void small_messages_vector(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		for (auto _ : state) {
+			std::vector<std::byte> buffer;
+
+			for (size_t i = 0; i < count; ++i) {
+				const u32 id     = static_cast<u32>(i);
+				const u16 length = static_cast<u16>(message_size);
+
+				const size_t at = buffer.size();
+
+				buffer.resize(at + 6 + message_size);
+
+				std::memcpy(buffer.data() + at, &id, 4);
+				std::memcpy(buffer.data() + at + 4, &length, 2);
+				std::memcpy(buffer.data() + at + 6, payload.data(), message_size);
+			}
+
+			benchmark::DoNotOptimize(buffer.data());
+		}
+
+		state.SetBytesProcessed(state.iterations() * count * (message_size + 6));
+	}
+
+	// one message per buffer, built and dropped: `small_byte_buffer` never allocates for it
+	template <typename Buffer>
+	void message_per_buffer(benchmark::State& state) {
+		for (auto _ : state) {
+			Buffer buffer(message_size + 6);
+
+			buffer.template construct_back<u32>(u32{ 1 });
+			buffer.template construct_back<u16>(static_cast<u16>(message_size));
+			buffer.copy_back(payload.data(), payload.size());
+
+			benchmark::DoNotOptimize(buffer.readable().data());
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	// ==== codec, `range(0)` values per pass
+
+	void encode_le_u32(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		byte_buffer buffer(count * 4);
+
+		for (auto _ : state) {
+			buffer.clear();
+
+			for (size_t i = 0; i < count; ++i) {
+				buffer.write_le<u32>(static_cast<u32>(i));
+			}
+
+			benchmark::DoNotOptimize(buffer.readable().data());
+		}
+
+		state.SetBytesProcessed(state.iterations() * count * 4);
+	}
+
+	void decode_le_u32(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		byte_buffer buffer(count * 4);
+
+		for (auto _ : state) {
+			state.PauseTiming();
+
+			buffer.clear();
+
+			for (size_t i = 0; i < count; ++i) {
+				buffer.write_le<u32>(static_cast<u32>(i));
+			}
+
+			state.ResumeTiming();
+
+			u64 sum = 0;
+
+			while (true) {
+				const gef::option<u32> value = buffer.read_le<u32>();
+
+				if (!value.has_value()) {
+					break;
+				}
+
+				sum += value.value_unchecked();
+			}
+
+			benchmark::DoNotOptimize(sum);
+		}
+
+		state.SetBytesProcessed(state.iterations() * count * 4);
+	}
+
+	void encode_le_u32_span(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		std::vector<u32> values(count);
+
+		for (size_t i = 0; i < count; ++i) {
+			values[i] = static_cast<u32>(i * 2654435761u);
+		}
+
+		byte_buffer buffer(count * 4);
+
+		for (auto _ : state) {
+			buffer.clear();
+			buffer.write_le(std::span<const u32>{ values });
+
+			benchmark::DoNotOptimize(buffer.readable().data());
+		}
+
+		state.SetBytesProcessed(state.iterations() * count * 4);
+	}
+
+	// varints of mixed widths, 1 to 5 bytes
+	void encode_varint(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		byte_buffer buffer(count * 5);
+
+		for (auto _ : state) {
+			buffer.clear();
+
+			for (size_t i = 0; i < count; ++i) {
+				buffer.write_varint((i * 2654435761u) >> (i % 32));
+			}
+
+			benchmark::DoNotOptimize(buffer.readable().data());
+		}
+
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+
+	void decode_varint(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		byte_buffer buffer(count * 5);
+
+		for (auto _ : state) {
+			state.PauseTiming();
+
+			buffer.clear();
+
+			for (size_t i = 0; i < count; ++i) {
+				buffer.write_varint((i * 2654435761u) >> (i % 32));
+			}
+
+			state.ResumeTiming();
+
+			u64 sum = 0;
+
+			while (true) {
+				const gef::option<u64> value = buffer.read_varint();
+
+				if (!value.has_value()) {
+					break;
+				}
+
+				sum += value.value_unchecked();
+			}
+
+			benchmark::DoNotOptimize(sum);
+		}
+
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+
+	// ==== cross-thread handoff of `range(0)` messages, the consumer runs on a second thread
+
+	void handoff_ring(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		for (auto _ : state) {
+			gef::ring_byte_buffer ring(64 * 1024);
+
+			std::jthread consumer([&] {
+				std::array<byte, message_size> out;
+
+				for (size_t i = 0; i < count; ++i) {
+					ring.read(out);
+				}
+			});
+
+			for (size_t i = 0; i < count; ++i) {
+				ring.write(payload);
+			}
+		}
+
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+
+	void handoff_mutex(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		for (auto _ : state) {
+			gef::mutex<byte_buffer> shared{ byte_buffer(64 * 1024) };
+
+			std::jthread consumer([&] {
+				std::array<byte, message_size> out;
+
+				for (size_t received = 0; received < count;) {
+					shared.lock([&](byte_buffer& buffer) {
+						while (buffer.size() >= message_size) {
+							buffer.load_front(out.data(), message_size);
+							++received;
+						}
+					});
+				}
+			});
+
+			for (size_t i = 0; i < count; ++i) {
+				shared.lock([&](byte_buffer& buffer) { buffer.copy_back(payload.data(), message_size); });
+			}
+		}
+
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+
+	// ==== hand-off latency: one message bounced back by a second thread, each iteration (real time) is two hand-offs
+
+	void ping_pong_ring(benchmark::State& state) {
+		gef::ring_byte_buffer ping(4096);
+		gef::ring_byte_buffer pong(4096);
+
+		std::atomic<bool> stop{ false };
+
+		std::jthread echo([&] {
+			std::array<byte, message_size> out;
+
+			while (!stop.load(std::memory_order_relaxed)) {
+				if (ping.try_read(out)) {
+					pong.write(out);
+				}
+			}
+		});
+
+		std::array<byte, message_size> reply;
+
+		for (auto _ : state) {
+			ping.write(payload);
+			pong.read(reply);
+		}
+
+		stop.store(true, std::memory_order_relaxed);
+	}
+
+	void ping_pong_mutex(benchmark::State& state) {
+		gef::mutex<byte_buffer> ping{ byte_buffer(4096) };
+		gef::mutex<byte_buffer> pong{ byte_buffer(4096) };
+
+		std::atomic<bool> stop{ false };
+
+		// one message out of `shared`, false if none is there yet
+		const auto try_take = [](gef::mutex<byte_buffer>& shared, std::array<byte, message_size>& out) {
+			return shared.lock([&](byte_buffer& buffer) {
+				if (buffer.size() < message_size) {
+					return false;
+				}
+
+				buffer.load_front(out.data(), message_size);
+
+				return true;
+			});
+		};
+
+		std::jthread echo([&] {
+			std::array<byte, message_size> out;
+
+			while (!stop.load(std::memory_order_relaxed)) {
+				if (try_take(ping, out)) {
+					pong.lock([&](byte_buffer& buffer) { buffer.copy_back(out.data(), message_size); });
+				}
+			}
+		});
+
+		std::array<byte, message_size> reply;
+
+		for (auto _ : state) {
+			ping.lock([&](byte_buffer& buffer) { buffer.copy_back(payload.data(), message_size); });
+
+			while (!try_take(pong, reply)) {}
+		}
+
+		stop.store(true, std::memory_order_relaxed);
+	}
+}
+
+BENCHMARK(small_messages_byte_buffer)->Arg(16)->Arg(1024);
+BENCHMARK(small_messages_vector)->Arg(16)->Arg(1024);
+
+BENCHMARK_TEMPLATE(message_per_buffer, byte_buffer);
+BENCHMARK_TEMPLATE(message_per_buffer, small_byte_buffer<128>);
+
+BENCHMARK(encode_le_u32)->Arg(1 << 16);
+BENCHMARK(decode_le_u32)->Arg(1 << 16);
+BENCHMARK(encode_le_u32_span)->Arg(1 << 16);
+BENCHMARK(encode_varint)->Arg(1 << 16);
+BENCHMARK(decode_varint)->Arg(1 << 16);
+
+BENCHMARK(handoff_ring)->Arg(1 << 18)->UseRealTime();
+BENCHMARK(handoff_mutex)->Arg(1 << 18)->UseRealTime();
+
+BENCHMARK(ping_pong_ring)->UseRealTime();
+BENCHMARK(ping_pong_mutex)->UseRealTime();
\ No newline at end of file
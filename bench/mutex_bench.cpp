@@ -0,0 +1,134 @@
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <random>
+
+#include "gef.hpp"
+
+// gef::mutex policies and the sharded map under contention, at 1 / 4 / 16 / 64 threads.
+// threads mostly read, 1 access in 16 writes
+
+namespace {
+
+	struct counters {
+		u64 a{ 0 };
+		u64 b{ 0 };
+	};
+
+	template <typename Lockable>
+	gef::mutex<counters, Lockable>& shared_counters() {
+		static gef::mutex<counters, Lockable> m;
+
+		return m;
+	}
+
+	template <typename Lockable>
+	void read_mostly(benchmark::State& state) {
+		auto& m = shared_counters<Lockable>();
+
+		u64 sum = 0;
+		u64 i   = static_cast<u64>(state.thread_index());
+
+		for (auto _ : state) {
+			if (++i % 16 == 0) {
+				m.lock([](counters& c) { ++c.a; ++c.b; });
+			}
+			else {
+				sum += m.shared_lock([](const counters& c) { return c.a + c.b; });
+			}
+		}
+
+		benchmark::DoNotOptimize(sum);
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	constexpr u64 map_keys = 1 << 16;
+
+	gef::mutex<std::unordered_map<u64, u64>>& single_map() {
+		static gef::mutex<std::unordered_map<u64, u64>> m = [] {
+			std::unordered_map<u64, u64> map;
+
+			for (u64 key = 0; key < map_keys; ++key) {
+				map.emplace(key, key);
+			}
+
+			return map;
+		}();
+
+		return m;
+	}
+
+	gef::concurrent_map<u64, u64>& sharded_map() {
+		static gef::concurrent_map<u64, u64> map;
+
+		static const bool filled = [] {
+			for (u64 key = 0; key < map_keys; ++key) {
+				map.emplace(key, key);
+			}
+
+			return true;
+		}();
+
+		benchmark::DoNotOptimize(filled);
+
+		return map;
+	}
+
+	void map_single_mutex(benchmark::State& state) {
+		auto& m = single_map();
+
+		std::mt19937_64 rng{ static_cast<u64>(state.thread_index()) };
+
+		u64 sum = 0;
+
+		for (auto _ : state) {
+			const u64 key = rng() % map_keys;
+
+			if (key % 16 == 0) {
+				m.lock([&](std::unordered_map<u64, u64>& map) { ++map[key]; });
+			}
+			else {
+				sum += m.shared_lock([&](const std::unordered_map<u64, u64>& map) { return map.find(key)->second; });
+			}
+		}
+
+		benchmark::DoNotOptimize(sum);
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	void map_sharded(benchmark::State& state) {
+		auto& m = sharded_map();
+
+		std::mt19937_64 rng{ static_cast<u64>(state.thread_index()) };
+
+		u64 sum = 0;
+
+		for (auto _ : state) {
+			const u64 key = rng() % map_keys;
+
+			if (key % 16 == 0) {
+				m.lock(key, [](u64& value) { ++value; });
+			}
+			else {
+				m.shared_lock(key, [&](const u64& value) { sum += value; });
+			}
+		}
+
+		benchmark::DoNotOptimize(sum);
+
+		state.SetItemsProcessed(state.iterations());
+	}
+}
+
+BENCHMARK_TEMPLATE(read_mostly, std::shared_mutex)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+BENCHMARK_TEMPLATE(read_mostly, std::mutex)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+BENCHMARK_TEMPLATE(read_mostly, gef::spin_lock)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+BENCHMARK_TEMPLATE(read_mostly, gef::seqlock)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+BENCHMARK_TEMPLATE(read_mostly, gef::rcu)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+
+BENCHMARK(map_single_mutex)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+BENCHMARK(map_sharded)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
\ No newline at end of file
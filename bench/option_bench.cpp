@@ -0,0 +1,170 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <concepts>
+
+#include "gef.hpp"
+
+// option copy / move costs: trivially copyable options in bulk, and the combinators on heavy payloads
+
+namespace {
+
+	// not trivially copyable, the element by element path `option<int>` used to take
+	struct boxed_int {
+		int value;
+
+		boxed_int(const int v) noexcept : value(v) {}
+		boxed_int(const boxed_int& other) noexcept : value(other.value) {}
+		boxed_int& operator=(const boxed_int& other) noexcept { value = other.value; return *this; }
+		~boxed_int() noexcept {}
+	};
+
+	// ==== copy / move / destruction follow T's triviality
+
+	static_assert(!std::is_trivially_copyable_v<gef::option<boxed_int>>);
+
+	// not trivial, copied / moved through the handwritten overloads
+	static_assert(std::copyable<gef::option<std::string>>);
+	static_assert(!std::is_trivially_copyable_v<gef::option<std::string>> && !std::is_trivially_destructible_v<gef::option<std::string>>);
+
+	// move only
+	static_assert(std::movable<gef::option<std::unique_ptr<int>>> && !std::copy_constructible<gef::option<std::unique_ptr<int>>>);
+	static_assert(!std::is_copy_assignable_v<gef::option<std::unique_ptr<int>>>);
+
+	// trivially copyable, not trivially default constructible
+	struct defaulted_member {
+		int v = 1;
+	};
+
+	static_assert(!std::is_trivially_default_constructible_v<defaulted_member>);
+	static_assert(std::is_trivially_copyable_v<gef::option<defaulted_member>>);
+
+	// ==== niches: an option of these is the size of its payload
+
+	enum class color : u8 { red, green, blue, none = 0xFF };
+
+	// would have a niche, but isn't trivially copyable
+	struct not_trivial {
+		not_trivial(const int value) noexcept : v(value) {}
+		not_trivial(const not_trivial& other) noexcept : v(other.v) {}
+
+		int v;
+	};
+}
+
+template <>
+struct gef::option_niche<color> : gef::enum_niche<color, color::none> {};
+
+template <>
+struct gef::option_niche<not_trivial> {
+	static not_trivial none() noexcept { return not_trivial{ -1 }; }
+
+	static bool is_none(const not_trivial& n) noexcept { return n.v == -1; }
+};
+
+namespace {
+
+	static_assert(sizeof(gef::option<int*>) == sizeof(int*));
+	static_assert(sizeof(gef::option<float>) == sizeof(float));
+	static_assert(sizeof(gef::option<double>) == sizeof(double));
+	static_assert(sizeof(gef::option<color>) == sizeof(color));
+	static_assert(sizeof(gef::option<gef::unique_ref<int>>) == sizeof(int*));
+	static_assert(sizeof(gef::option<gef::pool<int>::ref>) == sizeof(int*));
+
+	static_assert(!gef::has_option_niche<int>);
+	static_assert(!gef::has_option_niche<not_trivial>);
+	static_assert(sizeof(gef::option<not_trivial>) > sizeof(not_trivial));
+
+	template <typename T>
+	void copy_option_vector(benchmark::State& state) {
+		const std::vector<gef::option<T>> source(static_cast<size_t>(state.range(0)), gef::option<T>{ T{ 1 } });
+
+		for (auto _ : state) {
+			std::vector<gef::option<T>> copy = source;
+
+			benchmark::DoNotOptimize(copy.data());
+		}
+
+		state.SetBytesProcessed(state.iterations() * source.size() * sizeof(gef::option<T>));
+	}
+
+	// doubling a full array moves every slot
+	template <typename T>
+	void resize_sparse_array(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		for (auto _ : state) {
+			state.PauseTiming();
+
+			gef::sparse_array<T> array(capacity);
+
+			for (size_t index = 0; index < capacity; ++index) {
+				array.emplace_at(index, T{ static_cast<int>(index) });
+			}
+
+			state.ResumeTiming();
+
+			array.resize(capacity * 2);
+
+			benchmark::DoNotOptimize(array.capacity());
+		}
+
+		state.SetItemsProcessed(state.iterations() * capacity);
+	}
+
+	std::string heavy_string() {
+		return std::string(256, 'x');
+	}
+
+	// a chain of transforms over an lvalue: every step copies the payload
+	void transform_chain_copy(benchmark::State& state) {
+		for (auto _ : state) {
+			gef::option<std::string> opt{ heavy_string() };
+
+			auto result = opt
+				.transform([](const std::string& s) { return s + "a"; })
+				.transform([](const std::string& s) { return s + "b"; })
+				.or_else([] { return gef::option<std::string>{}; });
+
+			benchmark::DoNotOptimize(result);
+		}
+	}
+
+	// the same chain on rvalues: the payload is moved through
+	void transform_chain_move(benchmark::State& state) {
+		for (auto _ : state) {
+			gef::option<std::string> opt{ heavy_string() };
+
+			auto result = std::move(opt)
+				.transform([](std::string&& s) { return std::move(s += "a"); })
+				.transform([](std::string&& s) { return std::move(s += "b"); })
+				.or_else([] { return gef::option<std::string>{}; });
+
+			benchmark::DoNotOptimize(result);
+		}
+	}
+
+	void take_string(benchmark::State& state) {
+		gef::option<std::string> opt;
+
+		for (auto _ : state) {
+			opt = gef::option<std::string>{ heavy_string() };
+
+			benchmark::DoNotOptimize(opt.take());
+		}
+	}
+}
+
+BENCHMARK_TEMPLATE(copy_option_vector, int)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(copy_option_vector, boxed_int)->Arg(1 << 16);
+
+BENCHMARK_TEMPLATE(resize_sparse_array, int)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(resize_sparse_array, boxed_int)->Arg(1 << 16);
+
+BENCHMARK(transform_chain_copy);
+BENCHMARK(transform_chain_move);
+BENCHMARK(take_string);
\ No newline at end of file
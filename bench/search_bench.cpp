@@ -0,0 +1,127 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <cstdint>
+
+#include "gef.hpp"
+
+// scalar search over 1M floats with a third of the slots erased: `find_first`, `count_if` and `erase_where`
+// on the packed layout (mask word kernel) against the option layout (alive_vec loop) and the per-value
+// `first_if` / `for_each` / `erase_if` they replace. build with e.g. -march=native to bench the vectorized kernel
+
+namespace {
+
+	using option_array = gef::sparse_array<float>;
+	using packed_array = gef::packed_sparse_array<float>;
+
+	constexpr size_t search_count = 1'000'000;
+
+	// values in [0, 1), every slot emplaced then a random third erased
+	template <typename Array>
+	Array churned_floats() {
+		Array array(search_count);
+
+		std::mt19937_64 rng{ 11 };
+		std::uniform_real_distribution<float> dist{ 0.0f, 1.0f };
+
+		for (size_t index = 0; index < search_count; ++index) {
+			array.emplace_at(index, dist(rng));
+		}
+
+		for (size_t index = 0; index < search_count; ++index) {
+			if (rng() % 3 == 0) {
+				array.erase_at(index);
+			}
+		}
+
+		return array;
+	}
+
+	// no value matches, so every search is a full scan
+	constexpr auto never = [](const float value) { return value < 0.0f; };
+	constexpr auto upper = [](const float value) { return value > 0.5f; };
+	constexpr auto tail  = [](const float value) { return value > 0.9f; };
+
+	template <typename Array>
+	void find_first_miss(benchmark::State& state) {
+		Array array = churned_floats<Array>();
+
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(array.find_first(never));
+		}
+
+		state.SetItemsProcessed(state.iterations() * search_count);
+	}
+
+	template <typename Array>
+	void first_if_miss(benchmark::State& state) {
+		Array array = churned_floats<Array>();
+
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(array.first_if([](float& value) { return never(value); }));
+		}
+
+		state.SetItemsProcessed(state.iterations() * search_count);
+	}
+
+	template <typename Array>
+	void count_if_half(benchmark::State& state) {
+		Array array = churned_floats<Array>();
+
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(array.count_if(upper));
+		}
+
+		state.SetItemsProcessed(state.iterations() * search_count);
+	}
+
+	template <typename Array>
+	void for_each_count_half(benchmark::State& state) {
+		Array array = churned_floats<Array>();
+
+		for (auto _ : state) {
+			size_t count = 0;
+
+			array.for_each([&](float& value, size_t&) { count += upper(value); });
+
+			benchmark::DoNotOptimize(count);
+		}
+
+		state.SetItemsProcessed(state.iterations() * search_count);
+	}
+
+	// the erase itself is destructive, each iteration starts again from a copy outside the timed region
+	template <typename Array, bool Where>
+	void erase_tail(benchmark::State& state) {
+		const Array source = churned_floats<Array>();
+
+		for (auto _ : state) {
+			state.PauseTiming();
+			Array array = source;
+			state.ResumeTiming();
+
+			if constexpr (Where) {
+				benchmark::DoNotOptimize(array.erase_where(tail));
+			}
+			else {
+				array.erase_if([](float& value) { return tail(value); });
+			}
+
+			benchmark::DoNotOptimize(array.size());
+		}
+
+		state.SetItemsProcessed(state.iterations() * search_count);
+	}
+}
+
+BENCHMARK_TEMPLATE(find_first_miss, packed_array);
+BENCHMARK_TEMPLATE(find_first_miss, option_array);
+BENCHMARK_TEMPLATE(first_if_miss, packed_array);
+
+BENCHMARK_TEMPLATE(count_if_half, packed_array);
+BENCHMARK_TEMPLATE(count_if_half, option_array);
+BENCHMARK_TEMPLATE(for_each_count_half, packed_array);
+
+BENCHMARK_TEMPLATE(erase_tail, packed_array, true);
+BENCHMARK_TEMPLATE(erase_tail, option_array, true);
+BENCHMARK_TEMPLATE(erase_tail, packed_array, false);
\ No newline at end of file
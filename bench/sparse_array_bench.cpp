@@ -0,0 +1,219 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+#include <cstdint>
+
+#include "gef.hpp"
+
+// sparse_array slot churn, iteration, growth and joins, on the default, packed and paged layouts
+
+namespace {
+
+	using option_array = gef::sparse_array<u32>;
+	using packed_array = gef::packed_sparse_array<u32>;
+	using paged_array  = gef::paged_sparse_array<u32>;
+
+	// `capacity` slots, every other one alive
+	template <typename Array>
+	Array half_full(const size_t capacity) {
+		Array array(capacity);
+
+		for (size_t index = 0; index < capacity; index += 2) {
+			array.emplace_at(index, static_cast<u32>(index));
+		}
+
+		return array;
+	}
+
+	// emplace + erase at random alive slots, the spawn / despawn pattern of an entity pool
+	template <typename Array>
+	void emplace_erase_churn(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		Array array = half_full<Array>(capacity);
+
+		std::mt19937_64 rng{ 42 };
+
+		for (auto _ : state) {
+			const size_t victim = array.alive_vec[rng() % array.size()];
+
+			array.erase_at(victim);
+
+			benchmark::DoNotOptimize(array.emplace(u32{ 7 }));
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	// baseline for `next_empty_index`: scanning the slots for the first empty one, as a free list-less array has to
+	void linear_scan_empty_index(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		option_array array(capacity);
+
+		for (size_t index = 0; index + 1 < capacity; ++index) {
+			array.emplace_at(index, u32{ 1 });
+		}
+
+		for (auto _ : state) {
+			size_t index = 0;
+
+			while (index < capacity && array.contains(index)) {
+				++index;
+			}
+
+			benchmark::DoNotOptimize(index);
+		}
+	}
+
+	void free_list_empty_index(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		option_array array(capacity);
+
+		for (size_t index = 0; index + 1 < capacity; ++index) {
+			array.emplace_at(index, u32{ 1 });
+		}
+
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(array.next_empty_index());
+		}
+	}
+
+	// `for_each` after random churn, `sorted` puts `alive_vec` back in slot order first
+	template <typename Array, bool Sorted>
+	void iterate_after_churn(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		Array array = half_full<Array>(capacity);
+
+		std::mt19937_64 rng{ 7 };
+
+		for (size_t i = 0; i < capacity; ++i) {
+			array.erase_at(array.alive_vec[rng() % array.size()]);
+			array.emplace(u32{ 3 });
+		}
+
+		array.sorted_iteration = Sorted;
+
+		for (auto _ : state) {
+			u64 sum = 0;
+
+			array.for_each([&](u32& value, size_t&) { sum += value; });
+
+			benchmark::DoNotOptimize(sum);
+		}
+
+		state.SetItemsProcessed(state.iterations() * array.size());
+	}
+
+	// per-frame update over every alive value, serial against `parallel_for_each`
+	template <bool Parallel>
+	void update_alive(benchmark::State& state) {
+		const size_t count = static_cast<size_t>(state.range(0));
+
+		gef::packed_sparse_array<float> array(count);
+
+		for (size_t index = 0; index < count; ++index) {
+			array.emplace_at(index, static_cast<float>(index));
+		}
+
+		for (auto _ : state) {
+			if constexpr (Parallel) {
+				array.parallel_for_each([](float& value, size_t) { value = value * 0.99f + 1.0f; });
+			}
+			else {
+				array.for_each([](float& value, size_t&) { value = value * 0.99f + 1.0f; });
+			}
+
+			benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+
+	// `append_n` in small batches from empty, growth included
+	template <typename Array>
+	void append_batches(benchmark::State& state) {
+		const size_t total = static_cast<size_t>(state.range(0));
+
+		for (auto _ : state) {
+			Array array;
+
+			for (size_t done = 0; done < total; done += 16) {
+				array.append_n(16, [](const size_t index) { return static_cast<u32>(index); });
+			}
+
+			benchmark::DoNotOptimize(array.size());
+		}
+
+		state.SetItemsProcessed(state.iterations() * total);
+	}
+
+	// slots touched through a shared index space: 1 in 2 alive in `a`, 1 in 3 in `b`
+	template <typename Array>
+	void join_two(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		Array a = half_full<Array>(capacity);
+		Array b(capacity);
+
+		for (size_t index = 0; index < capacity; index += 3) {
+			b.emplace_at(index, static_cast<u32>(index));
+		}
+
+		for (auto _ : state) {
+			u64 sum = 0;
+
+			gef::join(a, b).for_each([&](u32& x, u32& y, size_t) { sum += x + y; });
+
+			benchmark::DoNotOptimize(sum);
+		}
+	}
+
+	// snapshot roundtrip through a byte_buffer
+	template <typename Array>
+	void snapshot_roundtrip(benchmark::State& state) {
+		const size_t capacity = static_cast<size_t>(state.range(0));
+
+		const Array source = half_full<Array>(capacity);
+
+		Array target;
+
+		byte_buffer buffer;
+
+		for (auto _ : state) {
+			source.serialize(buffer);
+
+			benchmark::DoNotOptimize(target.deserialize(buffer));
+		}
+
+		state.SetItemsProcessed(state.iterations() * source.size());
+	}
+}
+
+BENCHMARK_TEMPLATE(emplace_erase_churn, option_array)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(emplace_erase_churn, packed_array)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(emplace_erase_churn, paged_array)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+
+BENCHMARK(linear_scan_empty_index)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(free_list_empty_index)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+
+BENCHMARK_TEMPLATE(iterate_after_churn, option_array, false)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(iterate_after_churn, option_array, true)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(iterate_after_churn, packed_array, false)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(iterate_after_churn, packed_array, true)->Arg(1'000'000);
+
+BENCHMARK_TEMPLATE(update_alive, false)->Arg(500'000)->UseRealTime();
+BENCHMARK_TEMPLATE(update_alive, true)->Arg(500'000)->UseRealTime();
+
+BENCHMARK_TEMPLATE(append_batches, option_array)->Arg(100'000);
+BENCHMARK_TEMPLATE(append_batches, packed_array)->Arg(100'000);
+BENCHMARK_TEMPLATE(append_batches, paged_array)->Arg(100'000);
+
+BENCHMARK_TEMPLATE(join_two, option_array)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(join_two, packed_array)->Arg(1'000'000);
+
+BENCHMARK_TEMPLATE(snapshot_roundtrip, option_array)->Arg(100'000);
+BENCHMARK_TEMPLATE(snapshot_roundtrip, packed_array)->Arg(100'000);
\ No newline at end of file
@@ -1,8 +1,20 @@
 #pragma once
 
 #include "gef/better_types.hpp"
+#include "gef/parallel.hpp"
+#include "gef/arena.hpp"
 #include "gef/unique_ref.hpp"
+#include "gef/pool.hpp"
 #include "gef/option.hpp"
+#include "gef/sparse_storage.hpp"
+#include "gef/sparse_slots.hpp"
 #include "gef/sparse_array.hpp"
+#include "gef/soa_sparse_array.hpp"
+#include "gef/concurrent_sparse_array.hpp"
+#include "gef/join.hpp"
+#include "gef/mutex_stats.hpp"
 #include "gef/mutex_guard.hpp"
-#include "gef/byte_buffer.hpp"
\ No newline at end of file
+#include "gef/sharded.hpp"
+#include "gef/file_mapping.hpp"
+#include "gef/byte_buffer.hpp"
+#include "gef/ring_byte_buffer.hpp"
\ No newline at end of file
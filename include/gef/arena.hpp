@@ -0,0 +1,153 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+
+#include "better_types.hpp"
+
+namespace gef {
+
+	// Monotonic bump allocator. deallocation is a no-op, memory comes back all at once with `reset`.
+	// `reset` keeps the chunks, so a per-frame (or per-request) arena stops allocating once warmed up.
+	//
+	// Usable wherever a `std::pmr::memory_resource` is, for example:
+	//     gef::pmr::sparse_array<T> arr{ 1024, &frame_arena };
+	//     byte_buffer buf{ 256, &frame_arena };
+	class arena : public std::pmr::memory_resource {
+	public:
+
+		explicit arena(const size_t chunk_size = 64 * 1024,
+			std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept :
+			m_upstream(upstream),
+			m_next_chunk_size(std::max<size_t>(chunk_size, 64))
+		{}
+
+		arena(const arena&)            = delete;
+		arena& operator=(const arena&) = delete;
+
+		~arena() noexcept override {
+			release();
+		}
+
+		// frees everything allocated so far in O(1), the chunks are kept for reuse
+		void reset() noexcept {
+			m_current = 0;
+
+			if (!m_chunks.empty()) {
+				m_ptr = m_chunks.front().data;
+				m_end = m_ptr + m_chunks.front().size;
+			}
+		}
+
+		// frees everything and returns the chunks upstream
+		void release() noexcept {
+			for (const chunk& c : m_chunks) {
+				m_upstream->deallocate(c.data, c.size, alignof(std::max_align_t));
+			}
+
+			m_chunks.clear();
+
+			m_current = 0;
+			m_ptr     = nullptr;
+			m_end     = nullptr;
+		}
+
+		// total size of the chunks taken from upstream
+		size_t bytes_reserved() const noexcept {
+			size_t total = 0;
+
+			for (const chunk& c : m_chunks) {
+				total += c.size;
+			}
+
+			return total;
+		}
+
+	private:
+
+		void* do_allocate(const size_t bytes, const size_t alignment) override {
+			byte* p;
+
+			// compared as sizes, aligning may already step past the end of the chunk
+			const size_t left    = static_cast<size_t>(m_end - m_ptr);
+			const size_t padding = m_ptr == nullptr ? 0 : align_padding(m_ptr, alignment);
+
+			if (m_ptr == nullptr || padding > left || bytes > left - padding) {
+				p = next_chunk(bytes, alignment);
+			}
+			else {
+				p = m_ptr + padding;
+			}
+
+			m_ptr = p + bytes;
+
+			return p;
+		}
+
+		void do_deallocate(void*, size_t, size_t) noexcept override {}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+		// moves to the next kept chunk that fits, or takes a new one from upstream (sizes double)
+		byte* next_chunk(const size_t bytes, const size_t alignment) {
+			const size_t needed = bytes + alignment;
+
+			for (size_t i = m_current + 1; i < m_chunks.size(); ++i) {
+				if (m_chunks[i].size >= needed) {
+					std::swap(m_chunks[m_current + 1], m_chunks[i]);
+
+					return enter_chunk(m_current + 1, alignment);
+				}
+			}
+
+			const size_t size = std::max(m_next_chunk_size, needed);
+
+			m_next_chunk_size *= 2;
+
+			const chunk c{ static_cast<byte*>(m_upstream->allocate(size, alignof(std::max_align_t))), size };
+
+			const size_t index = m_chunks.empty() ? 0 : m_current + 1;
+
+			m_chunks.insert(m_chunks.begin() + index, c);
+
+			return enter_chunk(index, alignment);
+		}
+
+		byte* enter_chunk(const size_t index, const size_t alignment) noexcept {
+			m_current = index;
+			m_end     = m_chunks[index].data + m_chunks[index].size;
+
+			return align_up(m_chunks[index].data, alignment);
+		}
+
+		static size_t align_padding(const byte* p, const size_t alignment) noexcept {
+			const auto address = reinterpret_cast<std::uintptr_t>(p);
+
+			return (alignment - address % alignment) % alignment;
+		}
+
+		static byte* align_up(byte* p, const size_t alignment) noexcept {
+			return p + align_padding(p, alignment);
+		}
+
+	private:
+		struct chunk {
+			byte* data;
+			size_t size;
+		};
+
+		std::pmr::memory_resource* m_upstream;
+
+		std::vector<chunk> m_chunks;
+		size_t m_current{ 0 };
+		size_t m_next_chunk_size;
+
+		byte* m_ptr{ nullptr };
+		byte* m_end{ nullptr };
+	};
+}
\ No newline at end of file
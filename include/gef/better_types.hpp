@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 using i8  = int8_t;
 using i16 = int16_t;
@@ -16,4 +17,9 @@ using uint = unsigned int;
 
 using byte = i8;
 
-using cstr = const char*;
\ No newline at end of file
+using cstr = const char*;
+
+namespace gef {
+	// fixed instead of std::hardware_destructive_interference_size, which may differ between TUs
+	inline constexpr size_t cache_line_size = 64;
+}
\ No newline at end of file
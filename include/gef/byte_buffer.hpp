@@ -1,7 +1,74 @@
 #pragma once
 
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <span>
+#include <bit>
+#include <concepts>
+#include <memory>
+#include <memory_resource>
+#include <cassert>
+
 #include "better_types.hpp"
+#include "option.hpp"
+#include "file_mapping.hpp"
+
+namespace gef {
+
+	// what `byte_buffer::write_le` / `read_le` encode: integers and floats of 1, 2, 4 or 8 bytes.
+	// not bool, any byte above 1 would read back as an invalid bool. not long double, it has no same sized integer
+	template <typename T>
+	concept le_scalar = (std::integral<T> || std::floating_point<T>) && !std::same_as<T, bool> &&
+		(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+	// ==== the little-endian codec behind `byte_buffer`, also for decoding in place (e.g. `sparse_array::deserialize`)
+
+	template <le_scalar T>
+	using le_bits_t = std::conditional_t<sizeof(T) == 1, u8,
+		std::conditional_t<sizeof(T) == 2, u16,
+		std::conditional_t<sizeof(T) == 4, u32, u64>>>;
+
+	template <le_scalar T>
+	constexpr le_bits_t<T> to_le(const T value) noexcept {
+		const auto bits = std::bit_cast<le_bits_t<T>>(value);
+
+		if constexpr (std::endian::native == std::endian::little) {
+			return bits;
+		}
+		else {
+			return std::byteswap(bits);
+		}
+	}
 
+	template <le_scalar T>
+	constexpr T from_le(const le_bits_t<T> bits) noexcept {
+		if constexpr (std::endian::native == std::endian::little) {
+			return std::bit_cast<T>(bits);
+		}
+		else {
+			return std::bit_cast<T>(std::byteswap(bits));
+		}
+	}
+
+	// the `T` encoded at `src`, which needs not be aligned
+	template <le_scalar T>
+	T load_le(const byte* src) noexcept {
+		le_bits_t<T> bits;
+
+		std::memcpy(&bits, src, sizeof(T));
+
+		return from_le<T>(bits);
+	}
+}
+
+// Written at the back, read from the front, with independent cursors:
+// [0, read) consumed | [read, write) readable | [write, capacity) writable
+//
+// Heap backed (malloc, or a `std::pmr::memory_resource` such as `gef::arena`), or a file mapped with `map_file`.
+// see `small_byte_buffer` for inline storage that only spills to the heap when outgrown
 class byte_buffer {
 public:
 	byte_buffer() :
@@ -9,19 +76,71 @@ public:
 		_buffer_size(0)
 	{}
 
-	byte_buffer(const size_t init_bytes) :
-		buffer((byte*)std::malloc(init_bytes)),
-		_buffer_size(init_bytes)
-	{}
+	// `resource` null: malloc / realloc / free
+	byte_buffer(const size_t init_bytes, std::pmr::memory_resource* resource = nullptr) :
+		buffer(nullptr),
+		_buffer_size(0),
+		m_resource(resource)
+	{
+		reserve(init_bytes);
+	}
 
-	~byte_buffer() {
-		if (buffer != nullptr) {
-			std::free(buffer);
+	byte_buffer(const byte_buffer&) = delete;
+	byte_buffer& operator=(const byte_buffer&) = delete;
+
+	byte_buffer(byte_buffer&& other) noexcept :
+		byte_buffer()
+	{
+		take(other);
+	}
+
+	byte_buffer& operator=(byte_buffer&& other) noexcept {
+		if (this != &other) {
+			release();
+			take(other);
 		}
+
+		return *this;
+	}
+
+	~byte_buffer() {
+		release();
 	}
 
+	// grow to at least `init_bytes`, never shrinks.
+	// a read-write mapping grows its file. a read-only mapping, or one whose file can't grow, is first copied to the heap
 	void reserve(size_t init_bytes) {
-		if (buffer == nullptr) {
+		if (init_bytes <= _buffer_size) {
+			return;
+		}
+
+		if (m_mapping.is_open()) {
+			if (m_mapping.mode() == gef::map_mode::read_write && m_mapping.resize(init_bytes)) {
+				buffer       = m_mapping.data();
+				_buffer_size = m_mapping.size();
+			}
+			else {
+				detach_mapping(init_bytes);
+			}
+
+			return;
+		}
+
+		// inline storage can't be reallocated either
+		if (m_resource != nullptr || is_inline()) {
+			byte* grown = heap_allocate(init_bytes);
+
+			if (buffer != nullptr) {
+				std::memcpy(grown, buffer, write_pos);
+
+				if (!is_inline()) {
+					heap_free(buffer, _buffer_size);
+				}
+			}
+
+			buffer = grown;
+		}
+		else if (buffer == nullptr) {
 			buffer = (byte*)std::malloc(init_bytes);
 		}
 		else {
@@ -31,41 +150,542 @@ public:
 		_buffer_size = init_bytes;
 	}
 
+	// make room for at least `size` writable bytes, compacting or growing the buffer.
+	// amortized O(1): growing at least doubles the capacity
+	void reserve_writable(const size_t size) {
+		if (is_read_only_mapping()) {
+			detach_mapping(std::max(write_pos + size, _buffer_size));
+		}
+
+		if (write_pos + size <= _buffer_size) {
+			return;
+		}
+
+		// reclaim the consumed bytes first, when that moves no more than it frees
+		if (read_pos >= readable_size()) {
+			compact();
+		}
+
+		if (write_pos + size > _buffer_size) {
+			reserve(std::max(write_pos + size, _buffer_size * 2));
+		}
+	}
+
+	// grows the buffer if needed
 	void copy_back(const void* from, const size_t size) {
-		std::memcpy(buffer + rw_size, from, size);
-		rw_size += size;
+		reserve_writable(size);
+		copy_back_unchecked(from, size);
+	}
+
+	// caller guarantees `size` bytes fit, see `reserve`
+	void copy_back_unchecked(const void* from, const size_t size) {
+		std::memcpy(buffer + write_pos, from, size);
+		write_pos += size;
 	}
 
+	// grows the buffer if needed
 	template <typename T, typename ...Args>
 	void construct_back(Args ...args) {
-		new (buffer + rw_size) T{ std::forward<Args>(args)... };
-		rw_size += sizeof(T);
+		reserve_writable(sizeof(T));
+		construct_back_unchecked<T>(std::forward<Args>(args)...);
+	}
+
+	// caller guarantees `sizeof(T)` bytes fit, see `reserve`
+	template <typename T, typename ...Args>
+	void construct_back_unchecked(Args ...args) {
+		new (buffer + write_pos) T{ std::forward<Args>(args)... };
+		write_pos += sizeof(T);
 	}
 
 	void load_front(void* to, const size_t size) {
-		std::memcpy(to, buffer + rw_size, size);
-		rw_size += size;
+		std::memcpy(to, buffer + read_pos, size);
+		consume(size);
 	}
 
 	template <typename T>
 	T make_front() {
 		T t;
 
-		std::memcpy(&t, buffer + rw_size, sizeof(T));
+		std::memcpy(&t, buffer + read_pos, sizeof(T));
 
-		rw_size += sizeof(T);
+		consume(sizeof(T));
 
 		return t;
 	}
 
+	// ==== portable encoding
+	// little-endian fixed width (plain copies on little-endian hosts), LEB128 varints, length-prefixed bytes.
+	// reads return nullopt (and consume nothing) on truncated or malformed input
+
+	template <typename T>
+		requires(gef::le_scalar<T>)
+	void write_le(const T value) {
+		const auto bits = gef::to_le(value);
+
+		copy_back(&bits, sizeof(T));
+	}
+
+	template <typename T>
+		requires(gef::le_scalar<T>)
+	gef::option<T> read_le() {
+		if (readable_size() < sizeof(T)) {
+			return gef::nullopt;
+		}
+
+		const T value = gef::load_le<T>(buffer + read_pos);
+
+		consume(sizeof(T));
+
+		return value;
+	}
+
+	template <typename T>
+		requires(gef::le_scalar<T>)
+	void write_le(std::span<const T> values) {
+		const size_t bytes = values.size_bytes();
+
+		if constexpr (std::endian::native == std::endian::little) {
+			copy_back(values.data(), bytes);
+		}
+		else {
+			reserve_writable(bytes);
+
+			// plain loop over a raw destination, compilers vectorize the byteswaps
+			auto* dst = reinterpret_cast<gef::le_bits_t<T>*>(buffer + write_pos);
+
+			for (size_t i = 0; i < values.size(); ++i) {
+				const auto bits = gef::to_le(values[i]);
+
+				std::memcpy(dst + i, &bits, sizeof(T));
+			}
+
+			write_pos += bytes;
+		}
+	}
+
+	// all or nothing
+	template <typename T>
+		requires(gef::le_scalar<T>)
+	bool read_le(std::span<T> out) {
+		const size_t bytes = out.size_bytes();
+
+		if (readable_size() < bytes) {
+			return false;
+		}
+
+		load_front(out.data(), bytes);
+
+		if constexpr (std::endian::native != std::endian::little) {
+			for (T& value : out) {
+				value = gef::load_le<T>(reinterpret_cast<const byte*>(&value));
+			}
+		}
+
+		return true;
+	}
+
+	// LEB128, 1 byte per 7 bits
+	void write_varint(u64 value) {
+		reserve_writable(max_varint_size);
+
+		while (value >= 0x80) {
+			buffer[write_pos++] = static_cast<byte>(value | 0x80);
+			value >>= 7;
+		}
+
+		buffer[write_pos++] = static_cast<byte>(value);
+	}
+
+	gef::option<u64> read_varint() {
+		size_t length = 0;
+
+		gef::option<u64> value = peek_varint(length);
+
+		if (value.has_value()) {
+			consume(length);
+		}
+
+		return value;
+	}
+
+	// zigzag: small negative numbers stay small
+	void write_zigzag(const i64 value) {
+		write_varint((static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63));
+	}
+
+	gef::option<i64> read_zigzag() {
+		return read_varint().transform([](const u64 v) {
+			return static_cast<i64>((v >> 1) ^ (~(v & 1) + 1));
+		});
+	}
+
+	// varint length, then the bytes
+	void write_prefixed(std::span<const byte> data) {
+		write_varint(data.size());
+		copy_back(data.data(), data.size());
+	}
+
+	// view into the buffer, valid until the next write. don't write through it on a read-only mapping
+	gef::option<std::span<byte>> read_prefixed() {
+		size_t length = 0;
+
+		gef::option<u64> size = peek_varint(length);
+
+		if (size.is_null() || size.value_unchecked() > readable_size() - length) {
+			return gef::nullopt;
+		}
+
+		std::span<byte> data{ buffer + read_pos + length, static_cast<size_t>(size.value_unchecked()) };
+
+		consume(length + data.size());
+
+		return data;
+	}
+
+	// ==== file mapping
+
+	// replaces the contents with the file at `path`, mapped and readable from the front.
+	// only the pages actually read get loaded. false on failure, the buffer is then empty.
+	// `map_mode::read_only` pages fault on any write: read them through the const `readable()`, never through `buffer`.
+	// writing to the buffer (`copy_back`, `reserve_writable`, ...) copies it to the heap first
+	bool map_file(cstr path, const gef::map_mode mode) {
+		release();
+
+		if (!m_mapping.open(path, mode)) {
+			return false;
+		}
+
+		buffer       = m_mapping.data();
+		_buffer_size = m_mapping.size();
+		write_pos    = _buffer_size;
+		m_mapped_end = _buffer_size;
+
+		return true;
+	}
+
+	// a read-write mapping truncates its file to the end of its contents, dropping the capacity grown past it.
+	// the buffer is then empty
+	void unmap() {
+		if (m_mapping.is_open()) {
+			release();
+		}
+	}
+
+	// hint how the mapping will be read, see `gef::map_advice`. does nothing for heap buffers
+	void advise(const gef::map_advice advice, const size_t offset = 0, const size_t size = static_cast<size_t>(-1)) const {
+		m_mapping.advise(advice, offset, size);
+	}
+
+	constexpr bool is_mapped() const {
+		return m_mapping.is_open();
+	}
+
+	constexpr bool is_read_only_mapping() const {
+		return m_mapping.is_open() && m_mapping.mode() == gef::map_mode::read_only;
+	}
+
+	// ==== streaming
+
+	// written, not yet consumed. a read-only mapping is only readable through the const overload
+	std::span<byte> readable() {
+		assert(!is_read_only_mapping());
+
+		return { buffer + read_pos, readable_size() };
+	}
+
+	std::span<const byte> readable() const {
+		return { buffer + read_pos, readable_size() };
+	}
+
+	// free space after the written bytes. fill it directly (e.g. `recv`), then `commit`
+	std::span<byte> writable() {
+		return { buffer + write_pos, _buffer_size - write_pos };
+	}
+
+	std::span<const byte> writable() const {
+		return { buffer + write_pos, _buffer_size - write_pos };
+	}
+
+	// mark `size` bytes of `writable()` as written
+	void commit(const size_t size) {
+		write_pos += size;
+	}
+
+	// drop `size` bytes from the front of `readable()`
+	void consume(const size_t size) {
+		read_pos += size;
+
+		// drained: rewinding is free. not in a mapping, where the bytes before the cursors are the file
+		if (read_pos == write_pos && !m_mapping.is_open()) {
+			clear();
+		}
+	}
+
+	// move the unread bytes to the front of the buffer.
+	// a read-write mapping is left alone (its consumed bytes are still the file), a read-only one is copied to the heap first
+	void compact() {
+		if (read_pos == 0) {
+			return;
+		}
+
+		if (m_mapping.is_open()) {
+			if (m_mapping.mode() == gef::map_mode::read_write) {
+				return;
+			}
+
+			detach_mapping(_buffer_size);
+		}
+
+		const size_t unread = readable_size();
+
+		std::memmove(buffer, buffer + read_pos, unread);
+
+		read_pos  = 0;
+		write_pos = unread;
+	}
+
+	// drop everything, keep the capacity.
+	// a mapped file keeps its contents, new writes overwrite them from the start
+	void clear() {
+		if (m_mapping.is_open()) {
+			m_mapped_end = std::max(m_mapped_end, write_pos);
+		}
+
+		read_pos  = 0;
+		write_pos = 0;
+	}
+
+	// ====
+
+	// written, not yet consumed
+	constexpr size_t size() const {
+		return readable_size();
+	}
+
+	constexpr size_t capacity() const {
+		return _buffer_size;
+	}
+
 	constexpr size_t buffer_size() const {
 		return _buffer_size;
 	}
 
+	// the bytes still live in the inline storage of a `small_byte_buffer`
+	constexpr bool is_inline() const {
+		return m_inline != nullptr && buffer == m_inline;
+	}
+
+protected:
+	// starts out on `inline_storage`, which outlives the buffer and is never freed
+	byte_buffer(byte* inline_storage, const size_t inline_size, std::pmr::memory_resource* resource) :
+		buffer(inline_storage),
+		_buffer_size(inline_size),
+		m_resource(resource),
+		m_inline(inline_storage),
+		m_inline_size(inline_size)
+	{}
+
+private:
+	static constexpr size_t max_varint_size = 10;
+
+	byte* heap_allocate(const size_t size) {
+		if (m_resource != nullptr) {
+			return (byte*)m_resource->allocate(size, alignof(std::max_align_t));
+		}
+
+		return (byte*)std::malloc(size);
+	}
+
+	void heap_free(byte* p, const size_t size) {
+		if (m_resource != nullptr) {
+			m_resource->deallocate(p, size, alignof(std::max_align_t));
+		}
+		else {
+			std::free(p);
+		}
+	}
+
+	// continue on the heap with a copy of the mapped bytes: read-only mappings before they are written to,
+	// read-write ones whose file failed to grow (the file keeps what was written so far)
+	void detach_mapping(const size_t new_capacity) {
+		byte* copy = heap_allocate(new_capacity);
+
+		// a failed `file_mapping::resize` may leave nothing mapped, the bytes are only in the file then
+		const bool lost = m_mapping.data() == nullptr;
+
+		if (!lost && write_pos != 0) {
+			std::memcpy(copy, m_mapping.data(), std::min(write_pos, m_mapping.size()));
+		}
+
+		close_mapping();
+
+		if (lost) {
+			read_pos  = 0;
+			write_pos = 0;
+		}
+
+		buffer       = copy;
+		_buffer_size = new_capacity;
+	}
+
+	// a read-write file is truncated to the end of its contents, cutting the capacity grown past them
+	void close_mapping() {
+		if (m_mapping.mode() == gef::map_mode::read_write) {
+			// best effort, a failure only leaves the file longer
+			m_mapping.resize(std::max(m_mapped_end, write_pos));
+		}
+
+		m_mapping.close();
+
+		m_mapped_end = 0;
+	}
+
+	// back to the inline storage, if any
+	void release() {
+		if (m_mapping.is_open()) {
+			close_mapping();
+		}
+		else if (buffer != nullptr && !is_inline()) {
+			heap_free(buffer, _buffer_size);
+		}
+
+		buffer       = m_inline;
+		_buffer_size = m_inline_size;
+
+		clear();
+	}
+
+	// move the contents of `other` into this released buffer, `other` is left released.
+	// heap and mapped memory is adopted, inline bytes are copied
+	void take(byte_buffer& other) noexcept {
+		m_resource = other.m_resource;
+
+		if (other.is_inline()) {
+			if (other.write_pos != 0) {
+				reserve(other.write_pos);
+
+				std::memcpy(buffer, other.buffer, other.write_pos);
+			}
+
+			read_pos  = other.read_pos;
+			write_pos = other.write_pos;
+
+			other.clear();
+
+			return;
+		}
+
+		buffer       = other.buffer;
+		read_pos     = other.read_pos;
+		write_pos    = other.write_pos;
+		_buffer_size = other._buffer_size;
+		m_mapping    = std::move(other.m_mapping);
+		m_mapped_end = std::exchange(other.m_mapped_end, 0);
+
+		other.buffer       = other.m_inline;
+		other._buffer_size = other.m_inline_size;
+
+		other.clear();
+	}
+
+	constexpr size_t readable_size() const {
+		return write_pos - read_pos;
+	}
+
+	// decodes the varint at the read cursor without consuming it, `length` receives its encoded size
+	gef::option<u64> peek_varint(size_t& length) const {
+		u64 value = 0;
+
+		for (size_t i = 0; i < max_varint_size && i < readable_size(); ++i) {
+			const u64 part = static_cast<u8>(buffer[read_pos + i]);
+
+			// the 10th byte only has room for the top bit
+			if (i == max_varint_size - 1 && part > 1) {
+				return gef::nullopt;
+			}
+
+			value |= (part & 0x7f) << (7 * i);
+
+			if ((part & 0x80) == 0) {
+				length = i + 1;
+
+				return value;
+			}
+		}
+
+		return gef::nullopt;
+	}
+
 public:
+	// not writable on a read-only mapping, see `map_file`
 	byte* buffer;
 
 private:
-	size_t rw_size{ 0 };
+	size_t read_pos{ 0 };
+	size_t write_pos{ 0 };
 	size_t _buffer_size;
+
+	gef::file_mapping m_mapping;
+
+	// end of a mapped file's contents, once `clear` rewound the cursors below it
+	size_t m_mapped_end{ 0 };
+
+	std::pmr::memory_resource* m_resource{ nullptr };
+
+	byte* m_inline{ nullptr };
+	size_t m_inline_size{ 0 };
+};
+
+// `byte_buffer` with room for `N` bytes inline: no allocation until more than `N` bytes are needed,
+// then it spills to the heap (or its `std::pmr::memory_resource`) like a plain `byte_buffer`.
+// moving copies the inline bytes, a spilled buffer is adopted as is
+template <size_t N>
+class small_byte_buffer : public byte_buffer {
+public:
+	small_byte_buffer() :
+		byte_buffer(m_storage, N, nullptr)
+	{}
+
+	// spills to `resource` (null: malloc) once `N` is outgrown. tagged, a literal 0 would also convert to the pointer
+	small_byte_buffer(std::allocator_arg_t, std::pmr::memory_resource* resource) :
+		byte_buffer(m_storage, N, resource)
+	{}
+
+	// `init_bytes` beyond `N` spill right away
+	small_byte_buffer(const size_t init_bytes, std::pmr::memory_resource* resource = nullptr) :
+		small_byte_buffer(std::allocator_arg, resource)
+	{
+		reserve(init_bytes);
+	}
+
+	small_byte_buffer(small_byte_buffer&& other) noexcept :
+		small_byte_buffer()
+	{
+		byte_buffer::operator=(std::move(other));
+	}
+
+	small_byte_buffer(byte_buffer&& other) noexcept :
+		small_byte_buffer()
+	{
+		byte_buffer::operator=(std::move(other));
+	}
+
+	small_byte_buffer& operator=(small_byte_buffer&& other) noexcept {
+		byte_buffer::operator=(std::move(other));
+
+		return *this;
+	}
+
+	small_byte_buffer& operator=(byte_buffer&& other) noexcept {
+		byte_buffer::operator=(std::move(other));
+
+		return *this;
+	}
+
+	static constexpr size_t inline_capacity() {
+		return N;
+	}
+
+private:
+	alignas(std::max_align_t) byte m_storage[N];
 };
\ No newline at end of file
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <bit>
+#include <functional>
+#include <concepts>
+
+#include "better_types.hpp"
+#include "option.hpp"
+
+namespace gef {
+
+	// `gef::sparse_array` for many threads at once, with a fixed capacity between sync points.
+	//
+	// Any thread, concurrently:
+	//     emplace / emplace_at   lock-free, a slot is claimed with one CAS on an atomic occupancy bitmap
+	//     get / contains         wait-free
+	//     erase                  lock-free, the value stays readable and is destroyed at the next `sync`
+	//     for_each               sees every value published before the call, may see later ones
+	// Sync points (no other thread may use the array meanwhile):
+	//     sync, resize, compact, clear
+	//
+	// concurrent access to the same value is up to the caller, the array only guards the slots
+	template <typename T, typename Allocator = std::allocator<T>>
+	class concurrent_sparse_array {
+	public:
+
+		using allocator_type = Allocator;
+
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+	public:
+
+		concurrent_sparse_array() noexcept {}
+
+		explicit concurrent_sparse_array(const size_t capacity, const Allocator& alloc = Allocator()) noexcept :
+			m_alloc(alloc)
+		{
+			resize(capacity);
+		}
+
+		concurrent_sparse_array(const concurrent_sparse_array&)            = delete;
+		concurrent_sparse_array& operator=(const concurrent_sparse_array&) = delete;
+
+		~concurrent_sparse_array() noexcept {
+			release();
+		}
+
+		// ==== concurrent
+
+		// construct in an empty slot, and return its index. nullopt if full
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		gef::option<size_t> emplace(Args&&... args) noexcept {
+
+			const size_t words = word_count(m_capacity);
+
+			if (words == 0) {
+				return gef::nullopt;
+			}
+
+			// threads start at different cache lines of the bitmap, so they rarely CAS the same word
+			const size_t start = home_word(words);
+
+			for (size_t i = 0; i < words; ++i) {
+				const size_t w = (start + i) % words;
+
+				u64 bits = m_claimed[w].load(std::memory_order_relaxed);
+
+				// a failed CAS reloads `bits`
+				for (u64 free = ~bits & valid_bits(w); free != 0; free = ~bits & valid_bits(w)) {
+					const u64 bit = free & (~free + 1);
+
+					if (m_claimed[w].compare_exchange_weak(bits, bits | bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+						const size_t index = w * word_bits + std::countr_zero(bit);
+
+						publish(index, std::forward<Args>(args)...);
+
+						return index;
+					}
+				}
+			}
+
+			return gef::nullopt;
+		}
+
+		// false if `index` is taken (alive, or erased and not synced yet) or out of range
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		bool emplace_at(const size_t index, Args&&... args) noexcept {
+
+			if (index >= m_capacity) {
+				return false;
+			}
+
+			// in range, so also inside `valid_bits` of the last word
+			const u64 bit = u64{ 1 } << (index % word_bits);
+
+			if (m_claimed[index / word_bits].fetch_or(bit, std::memory_order_acquire) & bit) {
+				return false;
+			}
+
+			publish(index, std::forward<Args>(args)...);
+
+			return true;
+		}
+
+		constexpr bool contains(const size_t index) const noexcept {
+			return index < m_capacity &&
+				(m_ready[index / word_bits].load(std::memory_order_acquire) >> (index % word_bits)) & 1;
+		}
+
+		// the value stays valid until the next sync point, even if erased meanwhile
+		gef::option<T&> get(const size_t index) noexcept {
+			if (contains(index)) {
+				return m_values[index];
+			}
+
+			return gef::nullopt;
+		}
+
+		// hides the value, it is destroyed (and the slot freed) by the next `sync`. false if not alive
+		bool erase(const size_t index) noexcept {
+
+			if (index >= m_capacity) {
+				return false;
+			}
+
+			const u64 bit = u64{ 1 } << (index % word_bits);
+
+			if (m_ready[index / word_bits].fetch_and(~bit, std::memory_order_acq_rel) & bit) {
+				m_size.fetch_sub(1, std::memory_order_relaxed);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		// `f(value, index)` over the alive values, ascending
+		template <typename F>
+			requires(requires(F& f, T& v, size_t i) { { f(v, i) } -> std::same_as<void>; })
+		void for_each(F&& f) noexcept {
+
+			for (size_t w = 0; w < word_count(m_capacity); ++w) {
+				for (u64 bits = m_ready[w].load(std::memory_order_acquire); bits != 0; bits &= bits - 1) {
+					const size_t index = w * word_bits + std::countr_zero(bits);
+
+					std::invoke(f, m_values[index], index);
+				}
+			}
+		}
+
+		// exact only at a sync point
+		size_t size() const noexcept {
+			return m_size.load(std::memory_order_relaxed);
+		}
+
+		constexpr size_t capacity() const noexcept {
+			return m_capacity;
+		}
+
+		// ==== sync points
+
+		// destroys the erased values and frees their slots
+		void sync() noexcept {
+
+			for (size_t w = 0; w < word_count(m_capacity); ++w) {
+				const u64 ready = m_ready[w].load(std::memory_order_relaxed);
+
+				for (u64 erased = m_claimed[w].load(std::memory_order_relaxed) & ~ready; erased != 0; erased &= erased - 1) {
+					m_values[w * word_bits + std::countr_zero(erased)].~T();
+				}
+
+				m_claimed[w].store(ready, std::memory_order_relaxed);
+			}
+		}
+
+		// syncs, then moves the values into a buffer of `new_capacity` slots. values past it are destroyed
+		void resize(const size_t new_capacity) noexcept {
+
+			sync();
+
+			T* new_values = new_capacity == 0 ? nullptr : alloc_traits::allocate(m_alloc, new_capacity);
+
+			auto new_claimed = std::make_unique<std::atomic<u64>[]>(word_count(new_capacity));
+			auto new_ready   = std::make_unique<std::atomic<u64>[]>(word_count(new_capacity));
+
+			size_t kept = 0;
+
+			for_each_alive([&](const size_t index) {
+				if (index < new_capacity) {
+					new (new_values + index) T(std::move(m_values[index]));
+
+					const u64 bit = u64{ 1 } << (index % word_bits);
+
+					new_claimed[index / word_bits].fetch_or(bit, std::memory_order_relaxed);
+					new_ready[index / word_bits].fetch_or(bit, std::memory_order_relaxed);
+
+					++kept;
+				}
+			});
+
+			release();
+
+			m_values   = new_values;
+			m_claimed  = std::move(new_claimed);
+			m_ready    = std::move(new_ready);
+			m_capacity = new_capacity;
+
+			m_size.store(kept, std::memory_order_relaxed);
+		}
+
+		// syncs, then moves every value down to [0, size()), keeping their order.
+		// returns old slot -> new slot, `npos` for slots that were empty
+		std::vector<size_t> compact() noexcept {
+
+			sync();
+
+			std::vector<size_t> remap(m_capacity, npos);
+
+			size_t next = 0;
+
+			for_each_alive([&](const size_t index) {
+				remap[index] = next;
+
+				if (index != next) {
+					new (m_values + next) T(std::move(m_values[index]));
+					m_values[index].~T();
+				}
+
+				++next;
+			});
+
+			for (size_t w = 0; w < word_count(m_capacity); ++w) {
+				const size_t first = w * word_bits;
+
+				const u64 bits =
+					next >= first + word_bits ? ~u64{ 0 } :
+					next > first              ? (u64{ 1 } << (next - first)) - 1 :
+					                            0;
+
+				m_claimed[w].store(bits, std::memory_order_relaxed);
+				m_ready[w].store(bits, std::memory_order_relaxed);
+			}
+
+			return remap;
+		}
+
+		// Invalidates all data
+		void clear() noexcept {
+
+			sync();
+
+			for_each_alive([&](const size_t index) {
+				m_values[index].~T();
+			});
+
+			for (size_t w = 0; w < word_count(m_capacity); ++w) {
+				m_claimed[w].store(0, std::memory_order_relaxed);
+				m_ready[w].store(0, std::memory_order_relaxed);
+			}
+
+			m_size.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+
+		using alloc_traits = std::allocator_traits<Allocator>;
+
+		static constexpr size_t word_bits = 64;
+
+		static constexpr size_t word_count(const size_t slots) noexcept {
+			return (slots + word_bits - 1) / word_bits;
+		}
+
+		// the bits of word `w` that are real slots
+		constexpr u64 valid_bits(const size_t w) const noexcept {
+			const size_t left = m_capacity - w * word_bits;
+
+			return left >= word_bits ? ~u64{ 0 } : (u64{ 1 } << left) - 1;
+		}
+
+		// first word of the calling thread's cache line of the bitmap, fixed per thread
+		static size_t home_word(const size_t words) noexcept {
+			static thread_local const u64 thread_hash =
+				static_cast<u64>(std::hash<std::thread::id>{}(std::this_thread::get_id())) * 0x9E3779B97F4A7C15ull;
+
+			constexpr size_t words_per_line = cache_line_size / sizeof(u64);
+
+			const size_t lines = (words + words_per_line - 1) / words_per_line;
+
+			return static_cast<size_t>((thread_hash >> 32) % lines) * words_per_line;
+		}
+
+		// `index` is claimed by the caller
+		template <typename ...Args>
+		void publish(const size_t index, Args&&... args) noexcept {
+			new (m_values + index) T(std::forward<Args>(args)...);
+
+			m_size.fetch_add(1, std::memory_order_relaxed);
+
+			// release: readers that see the bit see the constructed value
+			m_ready[index / word_bits].fetch_or(u64{ 1 } << (index % word_bits), std::memory_order_release);
+		}
+
+		// sync points only
+		template <typename F>
+		void for_each_alive(F&& f) noexcept {
+			for (size_t w = 0; w < word_count(m_capacity); ++w) {
+				for (u64 bits = m_ready[w].load(std::memory_order_relaxed); bits != 0; bits &= bits - 1) {
+					std::invoke(f, w * word_bits + std::countr_zero(bits));
+				}
+			}
+		}
+
+		void release() noexcept {
+			if (m_values == nullptr) {
+				return;
+			}
+
+			sync();
+
+			for_each_alive([&](const size_t index) {
+				m_values[index].~T();
+			});
+
+			alloc_traits::deallocate(m_alloc, m_values, m_capacity);
+
+			m_values = nullptr;
+		}
+
+	private:
+		Allocator m_alloc;
+
+		T* m_values{ nullptr };
+		size_t m_capacity{ 0 };
+
+		// claimed: constructing, alive, or erased and waiting for `sync`. ready: alive
+		std::unique_ptr<std::atomic<u64>[]> m_claimed;
+		std::unique_ptr<std::atomic<u64>[]> m_ready;
+
+		alignas(cache_line_size) std::atomic<size_t> m_size{ 0 };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <utility>
+#include <algorithm>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "better_types.hpp"
+
+namespace gef {
+
+	enum class map_mode {
+		read_only,
+		// writes go back to the file. the file is created if missing
+		read_write
+	};
+
+	// access pattern hints, only a hint: the OS may ignore it
+	enum class map_advice {
+		normal,
+		sequential,
+		random,
+		// start reading the pages in now
+		willneed
+	};
+
+	// A whole file mapped into memory (mmap / MapViewOfFile). Move-only, unmaps on destruction
+	class file_mapping {
+	public:
+
+		file_mapping() noexcept = default;
+
+		file_mapping(const file_mapping&)            = delete;
+		file_mapping& operator=(const file_mapping&) = delete;
+
+		file_mapping(file_mapping&& other) noexcept :
+			m_data(std::exchange(other.m_data, nullptr)),
+			m_size(std::exchange(other.m_size, 0)),
+			m_mode(other.m_mode),
+			m_file(std::exchange(other.m_file, invalid_file))
+		{}
+
+		file_mapping& operator=(file_mapping&& other) noexcept {
+			std::swap(m_data, other.m_data);
+			std::swap(m_size, other.m_size);
+			std::swap(m_mode, other.m_mode);
+			std::swap(m_file, other.m_file);
+
+			return *this;
+		}
+
+		~file_mapping() noexcept {
+			close();
+		}
+
+		// ====
+
+		// maps the whole file, replacing any current mapping. false on failure
+		bool open(cstr path, const map_mode mode) noexcept {
+			close();
+
+			m_mode = mode;
+
+#if defined(_WIN32)
+			const bool rw = mode == map_mode::read_write;
+
+			m_file = ::CreateFileA(path, GENERIC_READ | (rw ? GENERIC_WRITE : 0), FILE_SHARE_READ, nullptr,
+				rw ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+			if (m_file == invalid_file) {
+				return false;
+			}
+
+			LARGE_INTEGER file_size;
+
+			if (!::GetFileSizeEx(m_file, &file_size)) {
+				close();
+				return false;
+			}
+
+			if (!map(static_cast<size_t>(file_size.QuadPart))) {
+				close();
+				return false;
+			}
+#else
+			m_file = ::open(path, mode == map_mode::read_write ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+
+			if (m_file == invalid_file) {
+				return false;
+			}
+
+			struct stat file_stat;
+
+			if (::fstat(m_file, &file_stat) != 0 || !map(static_cast<size_t>(file_stat.st_size))) {
+				close();
+				return false;
+			}
+#endif
+
+			return true;
+		}
+
+		// read_write only: grows or truncates the file to `new_size` and maps it whole. `data()` may move.
+		// false on failure, the old mapping is then put back when possible (`data()` is null otherwise)
+		bool resize(const size_t new_size) noexcept {
+			if (!is_open() || m_mode != map_mode::read_write) {
+				return false;
+			}
+
+			const size_t old_size = m_size;
+
+#if defined(_WIN32)
+			unmap();
+
+			// CreateFileMapping grows the file by itself, shrinking needs an explicit end of file
+			LARGE_INTEGER end;
+			end.QuadPart = static_cast<LONGLONG>(new_size);
+
+			if (::SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) && ::SetEndOfFile(m_file) && map(new_size)) {
+				return true;
+			}
+#else
+			// while still mapped, so a failure leaves everything as it was
+			if (::ftruncate(m_file, static_cast<off_t>(new_size)) != 0) {
+				return false;
+			}
+
+			unmap();
+
+			if (map(new_size)) {
+				return true;
+			}
+#endif
+
+			map(std::min(old_size, new_size));
+
+			return false;
+		}
+
+		// hint the access pattern of [offset, offset + size)
+		void advise(const map_advice advice, size_t offset = 0, size_t size = static_cast<size_t>(-1)) const noexcept {
+			if (m_data == nullptr || offset >= m_size) {
+				return;
+			}
+
+			size = std::min(size, m_size - offset);
+
+#if defined(_WIN32)
+			// only prefetching has an equivalent
+			if (advice == map_advice::willneed) {
+				WIN32_MEMORY_RANGE_ENTRY range{ m_data + offset, size };
+
+				::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+			}
+#else
+			// madvise wants a page aligned start
+			const size_t page    = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+			const size_t aligned = offset / page * page;
+
+			const int flag =
+				advice == map_advice::sequential ? MADV_SEQUENTIAL :
+				advice == map_advice::random     ? MADV_RANDOM :
+				advice == map_advice::willneed   ? MADV_WILLNEED :
+				                                   MADV_NORMAL;
+
+			::madvise(m_data + aligned, size + (offset - aligned), flag);
+#endif
+		}
+
+		void close() noexcept {
+			unmap();
+
+			if (m_file != invalid_file) {
+#if defined(_WIN32)
+				::CloseHandle(m_file);
+#else
+				::close(m_file);
+#endif
+				m_file = invalid_file;
+			}
+		}
+
+		// ====
+
+		constexpr byte* data() const noexcept { return m_data; }
+
+		constexpr size_t size() const noexcept { return m_size; }
+
+		constexpr map_mode mode() const noexcept { return m_mode; }
+
+		constexpr bool is_open() const noexcept { return m_file != invalid_file; }
+
+	private:
+
+		// empty files stay unmapped, `data()` is null
+		bool map(const size_t size) noexcept {
+			m_size = size;
+
+			if (size == 0) {
+				return true;
+			}
+
+			const bool rw = m_mode == map_mode::read_write;
+
+#if defined(_WIN32)
+			HANDLE mapping = ::CreateFileMappingA(m_file, nullptr, rw ? PAGE_READWRITE : PAGE_READONLY,
+				static_cast<DWORD>(static_cast<u64>(size) >> 32), static_cast<DWORD>(size), nullptr);
+
+			if (mapping == nullptr) {
+				m_size = 0;
+				return false;
+			}
+
+			// the view keeps the mapping object alive
+			void* view = ::MapViewOfFile(mapping, rw ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+
+			::CloseHandle(mapping);
+
+			if (view == nullptr) {
+				m_size = 0;
+				return false;
+			}
+#else
+			void* view = ::mmap(nullptr, size, PROT_READ | (rw ? PROT_WRITE : 0), MAP_SHARED, m_file, 0);
+
+			if (view == MAP_FAILED) {
+				m_size = 0;
+				return false;
+			}
+#endif
+
+			m_data = static_cast<byte*>(view);
+
+			return true;
+		}
+
+		void unmap() noexcept {
+			if (m_data != nullptr) {
+#if defined(_WIN32)
+				::UnmapViewOfFile(m_data);
+#else
+				::munmap(m_data, m_size);
+#endif
+				m_data = nullptr;
+			}
+
+			m_size = 0;
+		}
+
+	private:
+#if defined(_WIN32)
+		using file_t = HANDLE;
+		static inline const file_t invalid_file = INVALID_HANDLE_VALUE;
+#else
+		using file_t = int;
+		static constexpr file_t invalid_file = -1;
+#endif
+
+		byte* m_data{ nullptr };
+		size_t m_size{ 0 };
+		map_mode m_mode{ map_mode::read_only };
+		file_t m_file{ invalid_file };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <tuple>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <bit>
+#include <concepts>
+
+#include "better_types.hpp"
+
+namespace gef {
+
+	// anything shaped like `gef::sparse_array`
+	template <typename A>
+	concept joinable = requires(A& a, const size_t index) {
+		{ a.alive_vec.size() } -> std::convertible_to<size_t>;
+		{ a.contains(index) } -> std::same_as<bool>;
+		a.at(index);
+	};
+
+	// occupancy available as one bit per slot, see `gef::bitset_storage`
+	template <typename A>
+	concept mask_joinable = joinable<A> && requires(A& a) {
+		{ a.data_vec.mask()[0] } -> std::convertible_to<u64>;
+		{ a.data_vec.mask().size() } -> std::convertible_to<size_t>;
+	};
+
+	// Iteration over the indices alive in every one of several sparse arrays sharing an index space, see `gef::join`
+	template <joinable ...Arrays>
+	class join_view {
+	public:
+
+		constexpr explicit join_view(Arrays&... arrays) noexcept :
+			m_arrays(arrays...)
+		{}
+
+		// `f(values..., index)` for every index alive in all arrays, ascending when the occupancy masks are used.
+		// the arrays must not change structurally (emplace / erase) from within `f`.
+		//
+		// if every array has a bitmask (`gef::bitset_storage`) and they are dense enough, the masks are ANDed word by word,
+		// otherwise the smallest `alive_vec` drives and the others are probed with `contains`
+		template <typename F>
+			requires(std::invocable<F&, decltype(std::declval<Arrays&>().at(0))..., size_t>)
+		constexpr void for_each(F&& f) noexcept {
+			for_each(f, std::index_sequence_for<Arrays...>{});
+		}
+
+		// number of indices alive in every array
+		constexpr size_t count() noexcept {
+			size_t n = 0;
+
+			for_each([&](auto&&...) { ++n; });
+
+			return n;
+		}
+
+	private:
+
+		static constexpr bool all_masked = (mask_joinable<Arrays> && ...);
+
+		template <typename F, size_t ...Is>
+		constexpr void for_each(F& f, std::index_sequence<Is...>) noexcept {
+
+			const std::array<size_t, sizeof...(Arrays)> sizes{ std::get<Is>(m_arrays).alive_vec.size()... };
+
+			const size_t smallest = static_cast<size_t>(std::min_element(sizes.begin(), sizes.end()) - sizes.begin());
+
+			if constexpr (all_masked) {
+				const size_t words = std::min({ std::get<Is>(m_arrays).data_vec.mask().size()... });
+
+				// one mask word covers 64 slots, walking the words beats probing once more than 1 in 64 is alive
+				if (sizes[smallest] >= words) {
+					for (size_t w = 0; w < words; ++w) {
+						for (u64 bits = (std::get<Is>(m_arrays).data_vec.mask()[w] & ...); bits != 0; bits &= bits - 1) {
+							const size_t index = w * 64 + std::countr_zero(bits);
+
+							std::invoke(f, std::get<Is>(m_arrays).at(index)..., index);
+						}
+					}
+
+					return;
+				}
+			}
+
+			((Is == smallest ? drive<Is>(f, std::index_sequence<Is...>{}) : void()), ...);
+		}
+
+		template <size_t Driver, typename F, size_t ...Is>
+		constexpr void drive(F& f, std::index_sequence<Is...>) noexcept {
+			for (const size_t index : std::get<Driver>(m_arrays).alive_vec) {
+				if (((Is == Driver || std::get<Is>(m_arrays).contains(index)) && ...)) {
+					std::invoke(f, std::get<Is>(m_arrays).at(index)..., index);
+				}
+			}
+		}
+
+	private:
+		std::tuple<Arrays&...> m_arrays;
+	};
+
+	// Intersects sparse arrays that share an index space:
+	//     gef::join(positions, velocities).for_each([](vec3& p, vec3& v, size_t i) { p += v; });
+	template <joinable ...Arrays>
+		requires(sizeof...(Arrays) >= 1)
+	constexpr join_view<Arrays...> join(Arrays&... arrays) noexcept {
+		return join_view<Arrays...>{ arrays... };
+	}
+}
\ No newline at end of file
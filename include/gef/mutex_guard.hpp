@@ -1,12 +1,95 @@
 #pragma once
 
+#include <mutex>
 #include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <cstring>
+#include <bit>
 #include <type_traits>
+#include <concepts>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+#include "better_types.hpp"
+#include "mutex_stats.hpp"
 
 
 namespace gef {
 
-    template <class T>
+    // tells the CPU we are in a spin-wait loop
+    inline void cpu_relax() noexcept {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // Exclusive lock that spins for a short while, then parks the thread on the atomic (a futex on Linux,
+    // WaitOnAddress on Windows). Cheaper than std::shared_mutex whenever the critical section is short
+    class spin_lock {
+    public:
+
+        void lock() noexcept {
+            if (try_lock()) {
+                return;
+            }
+
+            for (uint spins = 0; spins < 128; ++spins) {
+                cpu_relax();
+
+                if (m_state.load(std::memory_order_relaxed) == unlocked && try_lock()) {
+                    return;
+                }
+            }
+
+            // announce a waiter, so unlock knows it has to wake someone
+            while (m_state.exchange(contended, std::memory_order_acquire) != unlocked) {
+                m_state.wait(contended, std::memory_order_relaxed);
+            }
+        }
+
+        bool try_lock() noexcept {
+            u32 expected = unlocked;
+
+            return m_state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void unlock() noexcept {
+            if (m_state.exchange(unlocked, std::memory_order_release) == contended) {
+                m_state.notify_one();
+            }
+        }
+
+    private:
+        static constexpr u32 unlocked  = 0;
+        static constexpr u32 locked    = 1;
+        static constexpr u32 contended = 2;
+
+        std::atomic<u32> m_state{ unlocked };
+    };
+
+    // `gef::mutex` policy: readers copy the value without taking any lock and retry if a writer got in between.
+    // For small trivially copyable values that are read far more often than written.
+    // `shared_lock(f)` calls `f` once, on a consistent private copy
+    struct seqlock {};
+
+    // `gef::mutex` policy: the value lives behind an atomic shared_ptr. `shared_lock(f)` runs `f` on the current
+    // snapshot without taking the writer lock, `lock(f)` copies the value, runs `f` on the copy, then publishes it.
+    // Writers pay a copy and an allocation.
+    // Not lock-free on libstdc++ or MSVC: their `std::atomic<std::shared_ptr>` guards the pointer with an internal
+    // lock, so taking a snapshot can briefly wait on another load or on a publish, but never on a running `f`
+    struct rcu {};
+
+    struct mutex_access;
+
+    // `Lockable` is any mutex type (std::mutex, gef::spin_lock, ...). `shared_lock` is exclusive
+    // unless it also has `lock_shared`. See `gef::seqlock` and `gef::rcu` for reads that skip the lock
+    template <class T, class Lockable = std::shared_mutex>
     class mutex {
     public:
 
@@ -28,9 +111,16 @@ namespace gef {
         template <typename F>
             requires(requires(F&& f, T& v) { { f(v) }; })
         constexpr auto shared_lock(F&& f) noexcept {
-            std::shared_lock lock{ m_mutex };
+            if constexpr (requires(Lockable& m) { m.lock_shared(); }) {
+                std::shared_lock lock{ m_mutex };
 
-            return std::invoke(std::forward<F>(f), value);
+                return std::invoke(std::forward<F>(f), value);
+            }
+            else {
+                std::scoped_lock lock{ m_mutex };
+
+                return std::invoke(std::forward<F>(f), value);
+            }
         }
 
         template <typename F_locked, typename F_failed>
@@ -45,13 +135,283 @@ namespace gef {
                 std::invoke(std::forward<F_locked>(f_locked), value);
             }
             else {
-                std::invoke(std::forward<F_failed>(f_failed), value);
+                std::invoke(std::forward<F_failed>(f_failed));
+            }
+        }
+
+        // tags this mutex in the GEF_MUTEX_STATS registry, no-op when stats are disabled
+        void set_name([[maybe_unused]] cstr name) noexcept {
+#if GEF_MUTEX_STATS
+            m_mutex.stats.set_name(name);
+#endif
+        }
+
+#if GEF_MUTEX_STATS
+        const mutex_stats& stats() const noexcept {
+            return m_mutex.stats;
+        }
+#endif
+
+    private:
+        friend struct mutex_access;
+
+        // std::mutex is bloated with ABI compatability, so the default is shared_mutex instead
+        instrumented_lock<Lockable> m_mutex;
+        T value;
+    };
+
+    template <class T>
+        requires(std::is_trivially_copyable_v<T>)
+    class mutex<T, seqlock> {
+    public:
+
+        template <typename ...Args>
+            requires(std::constructible_from<T, Args...>)
+        constexpr mutex(Args&&... args) noexcept :
+            value(std::forward<Args>(args)...) {}
+
+        template <typename F>
+            requires(requires(F&& f, T& v) { { f(v) }; })
+        constexpr auto lock(F&& f) noexcept {
+            std::scoped_lock lock{ m_writer };
+
+            write_guard guard{ m_sequence };
+
+            return std::invoke(std::forward<F>(f), value);
+        }
+
+        template <typename F>
+            requires(requires(F&& f, const T& v) { { f(v) }; })
+        constexpr auto shared_lock(F&& f) noexcept {
+            const T copy = read();
+
+            return std::invoke(std::forward<F>(f), copy);
+        }
+
+        template <typename F_locked, typename F_failed>
+            requires(
+                requires(F_locked&& f, T& v) { { f(v) }; } &&
+                requires(F_failed&& f) { { f() }; }
+            )
+        constexpr void try_lock(F_locked&& f_locked, F_failed&& f_failed) noexcept {
+            std::unique_lock lock{ m_writer, std::try_to_lock };
+
+            if (lock.owns_lock()) {
+                write_guard guard{ m_sequence };
+
+                std::invoke(std::forward<F_locked>(f_locked), value);
+            }
+            else {
+                std::invoke(std::forward<F_failed>(f_failed));
+            }
+        }
+
+        // tags this mutex in the GEF_MUTEX_STATS registry, no-op when stats are disabled
+        void set_name([[maybe_unused]] cstr name) noexcept {
+#if GEF_MUTEX_STATS
+            m_writer.stats.set_name(name);
+#endif
+        }
+
+#if GEF_MUTEX_STATS
+        const mutex_stats& stats() const noexcept {
+            return m_writer.stats;
+        }
+#endif
+
+    private:
+
+        // odd while a write is in progress
+        struct write_guard {
+            std::atomic<u32>& sequence;
+
+            write_guard(std::atomic<u32>& s) noexcept : sequence(s) {
+                sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+
+            ~write_guard() noexcept {
+                sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        };
+
+        T read() const noexcept {
+            alignas(T) byte copy[sizeof(T)];
+
+            for (uint spins = 0; ; ++spins) {
+                const u32 before = m_sequence.load(std::memory_order_acquire);
+
+                if ((before & 1) == 0) {
+                    // may tear, the sequence check below throws torn copies away
+                    std::memcpy(copy, &value, sizeof(T));
+                    std::atomic_thread_fence(std::memory_order_acquire);
+
+                    if (m_sequence.load(std::memory_order_relaxed) == before) {
+                        return std::bit_cast<T>(copy);
+                    }
+                }
+
+                cpu_relax();
             }
         }
 
     private:
-        // std::mutex is bloated with ABI compatability, so use shared_mutex instead
-        std::shared_mutex m_mutex;
+        std::atomic<u32> m_sequence{ 0 };
+        instrumented_lock<spin_lock> m_writer;
         T value;
     };
+
+    template <class T>
+    class mutex<T, rcu> {
+    public:
+
+        template <typename ...Args>
+            requires(std::constructible_from<T, Args...>)
+        mutex(Args&&... args) noexcept :
+            m_snapshot(std::make_shared<const T>(std::forward<Args>(args)...)) {}
+
+        // `f` works on a copy that is published when it returns, readers keep seeing the old value until then
+        template <typename F>
+            requires(std::copy_constructible<T> && requires(F&& f, T& v) { { f(v) }; })
+        auto lock(F&& f) noexcept {
+            std::scoped_lock lock{ m_writer };
+
+            return update(std::forward<F>(f));
+        }
+
+        // `f` sees the snapshot published before the call, writers don't wait for it
+        template <typename F>
+            requires(requires(F&& f, const T& v) { { f(v) }; })
+        auto shared_lock(F&& f) noexcept {
+            const std::shared_ptr<const T> snapshot = m_snapshot.load(std::memory_order_acquire);
+
+            return std::invoke(std::forward<F>(f), *snapshot);
+        }
+
+        template <typename F_locked, typename F_failed>
+            requires(
+                std::copy_constructible<T> &&
+                requires(F_locked&& f, T& v) { { f(v) }; } &&
+                requires(F_failed&& f) { { f() }; }
+            )
+        void try_lock(F_locked&& f_locked, F_failed&& f_failed) noexcept {
+            std::unique_lock lock{ m_writer, std::try_to_lock };
+
+            if (lock.owns_lock()) {
+                update(std::forward<F_locked>(f_locked));
+            }
+            else {
+                std::invoke(std::forward<F_failed>(f_failed));
+            }
+        }
+
+        // tags this mutex in the GEF_MUTEX_STATS registry, no-op when stats are disabled
+        void set_name([[maybe_unused]] cstr name) noexcept {
+#if GEF_MUTEX_STATS
+            m_writer.stats.set_name(name);
+#endif
+        }
+
+#if GEF_MUTEX_STATS
+        const mutex_stats& stats() const noexcept {
+            return m_writer.stats;
+        }
+#endif
+
+    private:
+
+        template <typename F>
+        auto update(F&& f) noexcept {
+            const std::shared_ptr<T> next = std::make_shared<T>(*m_snapshot.load(std::memory_order_relaxed));
+
+            // publish even when `f` returns something
+            struct publisher {
+                std::atomic<std::shared_ptr<const T>>& snapshot;
+                const std::shared_ptr<T>& next;
+
+                ~publisher() noexcept {
+                    snapshot.store(next, std::memory_order_release);
+                }
+            } publish{ m_snapshot, next };
+
+            return std::invoke(std::forward<F>(f), *next);
+        }
+
+    private:
+        std::atomic<std::shared_ptr<const T>> m_snapshot;
+        instrumented_lock<spin_lock> m_writer;
+    };
+
+    // lets the free functions below reach the lock and the value
+    struct mutex_access {
+        template <class T, class Lockable>
+        static constexpr auto& native(mutex<T, Lockable>& m) noexcept { return m.m_mutex; }
+
+        template <class T, class Lockable>
+        static constexpr T& value(mutex<T, Lockable>& m) noexcept { return m.value; }
+    };
+
+    // only lock based mutexes can be locked together, seqlock and rcu writers work on a private copy
+    template <class Lockable>
+    concept multi_lockable = !std::same_as<Lockable, seqlock> && !std::same_as<Lockable, rcu>;
+
+    // Locks every mutex without risking a deadlock (`std::lock`'s algorithm, whatever order they are passed in),
+    // then calls `f(values...)`. A mutex must not be passed twice
+    template <typename F, typename ...Ts, typename ...Lockables>
+        requires(
+            sizeof...(Ts) >= 1 && (multi_lockable<Lockables> && ...) &&
+            requires(F&& f, Ts&... v) { { f(v...) }; }
+        )
+    constexpr auto lock_all(F&& f, mutex<Ts, Lockables>&... mutexes) noexcept {
+        if constexpr (sizeof...(Ts) == 1) {
+            std::scoped_lock lock{ mutex_access::native(mutexes)... };
+
+            return std::invoke(std::forward<F>(f), mutex_access::value(mutexes)...);
+        }
+        else {
+#if GEF_MUTEX_STATS
+            // one acquisition per mutex, not std::lock's retries, see `lock_instrumented`
+            lock_instrumented(mutex_access::native(mutexes)...);
+#else
+            std::lock(mutex_access::native(mutexes)...);
+#endif
+
+            std::scoped_lock lock{ std::adopt_lock, mutex_access::native(mutexes)... };
+
+            return std::invoke(std::forward<F>(f), mutex_access::value(mutexes)...);
+        }
+    }
+
+    // Tries each mutex once. Either all of them are taken and `f_locked(values...)` is called,
+    // or none are held and `f_failed()` is called
+    template <typename F_locked, typename F_failed, typename ...Ts, typename ...Lockables>
+        requires(
+            sizeof...(Ts) >= 1 && (multi_lockable<Lockables> && ...) &&
+            requires(F_locked&& f, Ts&... v) { { f(v...) }; } &&
+            requires(F_failed&& f) { { f() }; }
+        )
+    constexpr void try_lock_all(F_locked&& f_locked, F_failed&& f_failed, mutex<Ts, Lockables>&... mutexes) noexcept {
+        bool locked;
+
+        if constexpr (sizeof...(Ts) == 1) {
+            locked = (mutex_access::native(mutexes).try_lock(), ...);
+        }
+        else {
+            // -1 when every lock was taken, otherwise the ones taken are already released
+#if GEF_MUTEX_STATS
+            locked = try_lock_instrumented(mutex_access::native(mutexes)...) == -1;
+#else
+            locked = std::try_lock(mutex_access::native(mutexes)...) == -1;
+#endif
+        }
+
+        if (locked) {
+            std::scoped_lock lock{ std::adopt_lock, mutex_access::native(mutexes)... };
+
+            std::invoke(std::forward<F_locked>(f_locked), mutex_access::value(mutexes)...);
+        }
+        else {
+            std::invoke(std::forward<F_failed>(f_failed));
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,353 @@
+#pragma once
+
+// Opt-in lock instrumentation for `gef::mutex`: define GEF_MUTEX_STATS to 1 before including gef.
+// (the same way in every translation unit). Disabled, `gef::instrumented_lock<L>` is just `L` and nothing here is compiled in
+#ifndef GEF_MUTEX_STATS
+    #define GEF_MUTEX_STATS 0
+#endif
+
+#if GEF_MUTEX_STATS
+    #include <atomic>
+    #include <chrono>
+    #include <mutex>
+    #include <vector>
+    #include <algorithm>
+    #include <cstdio>
+    #include <cinttypes>
+#endif
+
+#include "better_types.hpp"
+
+
+namespace gef {
+
+#if GEF_MUTEX_STATS
+
+    struct mutex_stats_snapshot {
+        // null unless `set_name` was called
+        cstr name;
+        // the stats inside the lock, tells unnamed locks apart
+        const void* address;
+
+        u64 acquisitions;
+        // acquisitions that had to wait
+        u64 contended;
+
+        u64 try_lock_attempts;
+        u64 try_lock_failures;
+
+        std::chrono::nanoseconds total_wait;
+        // exclusive holds only, shared holds overlap
+        std::chrono::nanoseconds max_hold;
+    };
+
+    // Counters of one mutex. Registers itself in the global registry for its whole lifetime
+    class mutex_stats {
+    public:
+
+        mutex_stats() noexcept;
+        ~mutex_stats() noexcept;
+
+        mutex_stats(const mutex_stats&)            = delete;
+        mutex_stats& operator=(const mutex_stats&) = delete;
+
+        // `tag` must outlive the mutex, a string literal usually
+        void set_name(cstr tag) noexcept {
+            name.store(tag, std::memory_order_relaxed);
+        }
+
+        mutex_stats_snapshot snapshot() const noexcept {
+            return {
+                name.load(std::memory_order_relaxed),
+                this,
+                acquisitions.load(std::memory_order_relaxed),
+                contended.load(std::memory_order_relaxed),
+                try_lock_attempts.load(std::memory_order_relaxed),
+                try_lock_failures.load(std::memory_order_relaxed),
+                std::chrono::nanoseconds{ total_wait_ns.load(std::memory_order_relaxed) },
+                std::chrono::nanoseconds{ max_hold_ns.load(std::memory_order_relaxed) }
+            };
+        }
+
+        void reset() noexcept {
+            acquisitions.store(0, std::memory_order_relaxed);
+            contended.store(0, std::memory_order_relaxed);
+            try_lock_attempts.store(0, std::memory_order_relaxed);
+            try_lock_failures.store(0, std::memory_order_relaxed);
+            total_wait_ns.store(0, std::memory_order_relaxed);
+            max_hold_ns.store(0, std::memory_order_relaxed);
+        }
+
+    public:
+        std::atomic<cstr> name{ nullptr };
+
+        std::atomic<u64> acquisitions{ 0 };
+        std::atomic<u64> contended{ 0 };
+        std::atomic<u64> try_lock_attempts{ 0 };
+        std::atomic<u64> try_lock_failures{ 0 };
+        std::atomic<u64> total_wait_ns{ 0 };
+        std::atomic<u64> max_hold_ns{ 0 };
+    };
+
+    // every live `mutex_stats`
+    class mutex_stats_registry {
+    public:
+
+        static mutex_stats_registry& get() noexcept {
+            // leaked, mutexes with static storage duration unregister during static destruction
+            static mutex_stats_registry& registry = *new mutex_stats_registry;
+
+            return registry;
+        }
+
+        std::vector<mutex_stats_snapshot> collect() noexcept {
+            std::scoped_lock lock{ m_mutex };
+
+            std::vector<mutex_stats_snapshot> out;
+            out.reserve(m_stats.size());
+
+            for (const mutex_stats* stats : m_stats) {
+                out.push_back(stats->snapshot());
+            }
+
+            return out;
+        }
+
+        // one line per mutex, most time spent waiting first
+        void dump(std::FILE* out = stderr) noexcept {
+            std::vector<mutex_stats_snapshot> all = collect();
+
+            std::sort(all.begin(), all.end(), [](const auto& a, const auto& b) { return a.total_wait > b.total_wait; });
+
+            for (const mutex_stats_snapshot& s : all) {
+                if (s.name != nullptr) {
+                    std::fprintf(out, "%s", s.name);
+                }
+                else {
+                    std::fprintf(out, "mutex %p", s.address);
+                }
+
+                std::fprintf(out,
+                    ": acquisitions %" PRIu64 ", contended %" PRIu64 ", try_lock failed %" PRIu64 "/%" PRIu64
+                    ", wait %" PRIu64 "us, max hold %" PRIu64 "us\n",
+                    s.acquisitions, s.contended, s.try_lock_failures, s.try_lock_attempts,
+                    static_cast<u64>(s.total_wait.count() / 1000), static_cast<u64>(s.max_hold.count() / 1000));
+            }
+        }
+
+        void reset() noexcept {
+            std::scoped_lock lock{ m_mutex };
+
+            for (mutex_stats* stats : m_stats) {
+                stats->reset();
+            }
+        }
+
+    private:
+        friend class mutex_stats;
+
+        void add(mutex_stats* stats) noexcept {
+            std::scoped_lock lock{ m_mutex };
+
+            m_stats.push_back(stats);
+        }
+
+        void remove(mutex_stats* stats) noexcept {
+            std::scoped_lock lock{ m_mutex };
+
+            std::erase(m_stats, stats);
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<mutex_stats*> m_stats;
+    };
+
+    inline mutex_stats::mutex_stats() noexcept {
+        mutex_stats_registry::get().add(this);
+    }
+
+    inline mutex_stats::~mutex_stats() noexcept {
+        mutex_stats_registry::get().remove(this);
+    }
+
+    // Wraps a lock and records into `stats`. Lock-free readers (`gef::seqlock`, `gef::rcu`) are not seen
+    template <class Lockable>
+    class instrumented_lock {
+        using clock = std::chrono::steady_clock;
+
+    public:
+
+        void lock() noexcept {
+            if (!m_lock.try_lock()) {
+                const clock::time_point start = clock::now();
+
+                m_lock.lock();
+
+                stats.contended.fetch_add(1, std::memory_order_relaxed);
+                stats.total_wait_ns.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+            }
+
+            acquired();
+        }
+
+        bool try_lock() noexcept {
+            stats.try_lock_attempts.fetch_add(1, std::memory_order_relaxed);
+
+            if (!m_lock.try_lock()) {
+                stats.try_lock_failures.fetch_add(1, std::memory_order_relaxed);
+
+                return false;
+            }
+
+            acquired();
+
+            return true;
+        }
+
+        void unlock() noexcept {
+            const u64 held = elapsed_ns(m_hold_start);
+
+            m_lock.unlock();
+
+            u64 max = stats.max_hold_ns.load(std::memory_order_relaxed);
+
+            while (held > max && !stats.max_hold_ns.compare_exchange_weak(max, held, std::memory_order_relaxed)) {}
+        }
+
+        void lock_shared() noexcept
+            requires(requires(Lockable& l) { l.lock_shared(); })
+        {
+            if (!m_lock.try_lock_shared()) {
+                const clock::time_point start = clock::now();
+
+                m_lock.lock_shared();
+
+                stats.contended.fetch_add(1, std::memory_order_relaxed);
+                stats.total_wait_ns.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+            }
+
+            stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool try_lock_shared() noexcept
+            requires(requires(Lockable& l) { l.try_lock_shared(); })
+        {
+            stats.try_lock_attempts.fetch_add(1, std::memory_order_relaxed);
+
+            if (!m_lock.try_lock_shared()) {
+                stats.try_lock_failures.fetch_add(1, std::memory_order_relaxed);
+
+                return false;
+            }
+
+            stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        void unlock_shared() noexcept
+            requires(requires(Lockable& l) { l.unlock_shared(); })
+        {
+            m_lock.unlock_shared();
+        }
+
+        // ==== for `gef::lock_all` / `gef::try_lock_all`: they take `untracked()` through `std::lock` / `std::try_lock`,
+        // whose back-off retries must not show up as try_lock attempts, and record each lock once
+
+        Lockable& untracked() noexcept {
+            return m_lock;
+        }
+
+        // `untracked()` was locked, after waiting `wait_ns` when `contended`
+        void record_lock(const bool contended, const u64 wait_ns) noexcept {
+            if (contended) {
+                stats.contended.fetch_add(1, std::memory_order_relaxed);
+                stats.total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+            }
+
+            acquired();
+        }
+
+        // one try_lock of `untracked()`. `taken`: it succeeded and the lock is kept
+        void record_try_lock(const bool taken) noexcept {
+            stats.try_lock_attempts.fetch_add(1, std::memory_order_relaxed);
+
+            if (taken) {
+                acquired();
+            }
+            else {
+                stats.try_lock_failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+
+        void acquired() noexcept {
+            stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+
+            // only the holder writes it
+            m_hold_start = clock::now();
+        }
+
+        static u64 elapsed_ns(const clock::time_point start) noexcept {
+            return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+        }
+
+    public:
+        mutex_stats stats;
+
+    private:
+        Lockable m_lock;
+        clock::time_point m_hold_start;
+    };
+
+    // `std::lock` over several instrumented locks, one acquisition each.
+    // the lock found busy by the first attempt is the contended one, it waited until all of them were taken
+    template <class ...Lockables>
+    void lock_instrumented(instrumented_lock<Lockables>&... locks) noexcept {
+        const int busy = std::try_lock(locks.untracked()...);
+
+        if (busy == -1) {
+            (locks.record_lock(false, 0), ...);
+
+            return;
+        }
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::lock(locks.untracked()...);
+
+        const u64 wait_ns = static_cast<u64>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+        int i = 0;
+
+        (locks.record_lock(i++ == busy, wait_ns), ...);
+    }
+
+    // `std::try_lock` over several instrumented locks, -1 if all of them were taken.
+    // on failure only the lock that could not be taken records an attempt, the ones released again before it are not counted
+    template <class ...Lockables>
+    int try_lock_instrumented(instrumented_lock<Lockables>&... locks) noexcept {
+        const int failed = std::try_lock(locks.untracked()...);
+
+        if (failed == -1) {
+            (locks.record_try_lock(true), ...);
+        }
+        else {
+            int i = 0;
+
+            ((i++ == failed ? locks.record_try_lock(false) : void()), ...);
+        }
+
+        return failed;
+    }
+
+#else
+
+    template <class Lockable>
+    using instrumented_lock = Lockable;
+
+#endif
+}
\ No newline at end of file
@@ -5,7 +5,10 @@
 #include <utility>
 #include <concepts>
 #include <variant>
+#include <bit>
+#include <cstdint>
 
+#include "better_types.hpp"
 #include "unique_ref.hpp"
 
 namespace gef {
@@ -16,8 +19,73 @@ namespace gef {
     template <typename T>
     class option;
 
+    // Niche hook: specialize for a type that has a bit pattern it never uses as a real value,
+    // then `option<T>` stores that pattern instead of a separate flag, and `sizeof(option<T>) == sizeof(T)`.
+    // A specialization provides
+    //     static constexpr T none() noexcept;                // the pattern an empty option holds
+    //     static constexpr bool is_none(const T&) noexcept;
+    // Only trivially copyable types are niche optimized. Setting an option to `none()` itself empties it.
+    // `constexpr` may be dropped when the pattern cannot be formed at compile time, then `option<T>` can't be
+    // created or queried in a constant expression, see the pointer niche
+    template <typename T>
+    struct option_niche {};
+
+    template <typename T>
+    concept has_option_niche = std::is_trivially_copyable_v<T> && requires(const T& v) {
+        { option_niche<T>::none() } -> std::same_as<T>;
+        { option_niche<T>::is_none(v) } -> std::same_as<bool>;
+    };
+
+    // enums with a spare value:
+    //     template <> struct gef::option_niche<color> : gef::enum_niche<color, color(0xFF)> {};
+    template <typename E, E Sentinel>
+        requires(std::is_enum_v<E>)
+    struct enum_niche {
+        static constexpr E none() noexcept { return Sentinel; }
+
+        static constexpr bool is_none(const E& e) noexcept { return e == Sentinel; }
+    };
+
+    // all bits set, never a pointer to a real object. null stays a valid value.
+    // not constexpr: an integer can't become a pointer at compile time (`reinterpret_cast`),
+    // so unlike the flag layout `option<T*>` is neither constructed nor checked in a constant expression
+    template <typename T>
+    struct option_niche<T*> {
+        static T* none() noexcept { return reinterpret_cast<T*>(~std::uintptr_t{ 0 }); }
+
+        static bool is_none(T* const& p) noexcept { return p == none(); }
+    };
+
+    // one quiet NaN payload is reserved, every other NaN is still a value
+    template <>
+    struct option_niche<float> {
+        static constexpr u32 none_bits = 0x7FC0'DEADu;
+
+        static constexpr float none() noexcept { return std::bit_cast<float>(none_bits); }
+
+        static constexpr bool is_none(const float& f) noexcept { return std::bit_cast<u32>(f) == none_bits; }
+    };
+
+    template <>
+    struct option_niche<double> {
+        static constexpr u64 none_bits = 0x7FF8'0000'DEAD'BEEFull;
+
+        static constexpr double none() noexcept { return std::bit_cast<double>(none_bits); }
+
+        static constexpr bool is_none(const double& d) noexcept { return std::bit_cast<u64>(d) == none_bits; }
+    };
+
     template <typename T>
     class OptionMethods {
+        // the value as `self` was passed: moved out of rvalue options, never out of an option of reference
+        template <typename Self>
+        using forwarded_t = std::conditional_t<std::is_lvalue_reference_v<T>, T, decltype(std::forward_like<Self>(std::declval<T&>()))>;
+
+        template <typename Self>
+        static constexpr forwarded_t<Self> forward_value(Self&& opt) noexcept {
+            return static_cast<forwarded_t<Self>>(opt.value_unchecked());
+        }
+
     public:
         constexpr bool is_null(this auto&& self) noexcept { return !self.has_value(); }
 
@@ -52,39 +120,55 @@ namespace gef {
             return self;
         }
 
-        // map. if has value, return an option from the result of `f`, otherwise return nullopt
-        template <typename F, typename U = std::invoke_result_t<F, T>>
-            requires(requires(F&& f, T const& v) { { f(v) } -> std::convertible_to<U>; })
-        constexpr option<U> transform(this auto&& self, F&& f) noexcept {
+        // map. if has value, return an option from the result of `f`, otherwise return nullopt.
+        // called on an rvalue (`std::move(opt).transform(f)`), `f` gets the value as an rvalue
+        template <typename Self, typename F, typename U = std::invoke_result_t<F, forwarded_t<Self>>>
+            requires(requires(F&& f, forwarded_t<Self>&& v) { { f(std::forward<forwarded_t<Self>>(v)) } -> std::convertible_to<U>; })
+        constexpr option<U> transform(this Self&& self, F&& f) noexcept {
             if (self.has_value()) {
-                return option<U>{ std::invoke(std::forward<F>(f), self.value_unchecked()) };
+                return option<U>{ std::invoke(std::forward<F>(f), forward_value(std::forward<Self>(self))) };
             }
 
             return option<U>{};
         }
 
-        // flatmap. if has value, return the result of `f` (f should return an option), otherwise return nullopt
-        template <typename U, typename F>
-            requires(requires(F&& f, T const& v) { { f(v) } -> std::convertible_to<option<U>>; })
-        constexpr option<U> and_then(this auto&& self, F&& f) noexcept {
+        // flatmap. if has value, return the result of `f` (f should return an option), otherwise return nullopt.
+        // moves the value into `f` when called on an rvalue
+        template <typename U, typename Self, typename F>
+            requires(requires(F&& f, forwarded_t<Self>&& v) { { f(std::forward<forwarded_t<Self>>(v)) } -> std::convertible_to<option<U>>; })
+        constexpr option<U> and_then(this Self&& self, F&& f) noexcept {
             if (self.has_value()) {
-                return std::invoke(std::forward<F>(f), self.value_unchecked());
+                return std::invoke(std::forward<F>(f), forward_value(std::forward<Self>(self)));
             }
 
             return option<U>{};
         }
 
-        // return self if has value, otherwise return an option from `f` (an option of the same type)
-        template <typename F>
+        // return self if has value, otherwise return an option from `f` (an option of the same type).
+        // self is moved, not copied, out of an rvalue
+        template <typename Self, typename F>
             requires(requires(F&& f) { { f() } -> std::convertible_to<option<T>>; })
-        constexpr option<T> or_else(this auto&& self, F&& f) noexcept {
+        constexpr option<T> or_else(this Self&& self, F&& f) noexcept {
             if (self.has_value()) {
-                return self;
+                return std::forward<Self>(self);
             }
 
             return std::invoke(std::forward<F>(f));
         }
 
+        // moves the value out and leaves self null
+        constexpr option<T> take(this auto& self) noexcept {
+            if (!self.has_value()) {
+                return option<T>{};
+            }
+
+            option<T> taken{ std::move(self.value_unchecked()) };
+
+            self.reset();
+
+            return taken;
+        }
+
         // if self has value run `f`, otherwise return provided value
         template <typename F, typename R>
             requires(requires(F&& f, T& v) { { f(v) } -> std::convertible_to<R>; })
@@ -119,24 +203,84 @@ namespace gef {
 
         constexpr option() noexcept : m_empty(), m_is_some(false) {}
 
-        constexpr option(option&) noexcept = default;
-        constexpr option(option&&) noexcept = default;
+        // copy / move / destruction are trivial whenever they are for `T`, so vectors of options memcpy
 
-        constexpr option(option const& other) noexcept {
-            m_is_some = other.m_is_some;
+        constexpr option(option const&) noexcept
+            requires(std::is_trivially_copy_constructible_v<T>) = default;
 
+        constexpr option(option const& other) noexcept
+            requires(!std::is_trivially_copy_constructible_v<T> && std::copy_constructible<T>)
+            : m_empty(), m_is_some(other.m_is_some)
+        {
             if (m_is_some) {
                 new (&m_value) T(other.m_value);
             }
         }
 
+        constexpr option(option&&) noexcept
+            requires(std::is_trivially_move_constructible_v<T>) = default;
+
+        // `other` keeps its (moved from) value
+        constexpr option(option&& other) noexcept
+            requires(!std::is_trivially_move_constructible_v<T> && std::move_constructible<T>)
+            : m_empty(), m_is_some(other.m_is_some)
+        {
+            if (m_is_some) {
+                new (&m_value) T(std::move(other.m_value));
+            }
+        }
+
+        constexpr option& operator=(option const&) noexcept
+            requires(std::is_trivially_copy_assignable_v<T> && std::is_trivially_copy_constructible_v<T> &&
+                std::is_trivially_destructible_v<T>) = default;
+
+        constexpr option& operator=(option const& rhs) noexcept
+            requires(!(std::is_trivially_copy_assignable_v<T> && std::is_trivially_copy_constructible_v<T> &&
+                std::is_trivially_destructible_v<T>) && std::copy_constructible<T>)
+        {
+            if (this != &rhs) {
+                reset();
+
+                if (rhs.m_is_some) {
+                    new (&m_value) T(rhs.m_value);
+                    m_is_some = true;
+                }
+            }
+
+            return *this;
+        }
+
+        constexpr option& operator=(option&&) noexcept
+            requires(std::is_trivially_move_assignable_v<T> && std::is_trivially_move_constructible_v<T> &&
+                std::is_trivially_destructible_v<T>) = default;
+
+        constexpr option& operator=(option&& rhs) noexcept
+            requires(!(std::is_trivially_move_assignable_v<T> && std::is_trivially_move_constructible_v<T> &&
+                std::is_trivially_destructible_v<T>) && std::move_constructible<T>)
+        {
+            if (this != &rhs) {
+                reset();
+
+                if (rhs.m_is_some) {
+                    new (&m_value) T(std::move(rhs.m_value));
+                    m_is_some = true;
+                }
+            }
+
+            return *this;
+        }
+
+        constexpr ~option() noexcept
+            requires(std::is_trivially_destructible_v<T>) = default;
+
         constexpr ~option() noexcept { reset(); }
 
         // explicit nullopt
         constexpr option(nullopt_t) noexcept : m_empty(), m_is_some(false) {}
 
+        // not a copy, those go through the constructors above
         template <typename ...Args>
-             requires(std::constructible_from<T, Args...>)
+             requires(std::constructible_from<T, Args...> && !(sizeof...(Args) == 1 && (std::same_as<std::remove_cvref_t<Args>, option> && ...)))
         constexpr option(Args&&... args) noexcept :
              m_value(std::forward<Args>(args)...), m_is_some(true) {}
 
@@ -186,6 +330,61 @@ namespace gef {
         bool m_is_some;
     };
 
+    static_assert(std::is_trivially_copyable_v<option<size_t>> && std::is_trivially_destructible_v<option<size_t>>);
+
+    // Niche optimized option, see `option_niche`. Same size as `T`
+    template <typename T>
+        requires(has_option_niche<T>)
+    class option<T> : public OptionMethods<T> {
+        using niche = option_niche<T>;
+
+    public:
+
+        constexpr option() noexcept : m_value(niche::none()) {}
+
+        constexpr option(option&) noexcept       = default;
+        constexpr option(option const&) noexcept = default;
+        constexpr option(option&&) noexcept      = default;
+
+        constexpr option& operator=(option const&) noexcept = default;
+        constexpr option& operator=(option&&) noexcept      = default;
+
+        constexpr ~option() noexcept = default;
+
+        // explicit nullopt
+        constexpr option(nullopt_t) noexcept : m_value(niche::none()) {}
+
+        template <typename ...Args>
+            requires(std::constructible_from<T, Args...>)
+        constexpr option(Args&&... args) noexcept :
+            m_value(std::forward<Args>(args)...) {}
+
+        // ====
+
+        template <typename ...Args>
+            requires(std::constructible_from<T, Args...>)
+        constexpr T& set(Args&&... args) noexcept {
+            m_value = T(std::forward<Args>(args)...);
+
+            return value_unchecked();
+        }
+
+        constexpr option& replace(option&& rhs) noexcept {
+            m_value = rhs.m_value;
+
+            return *this;
+        }
+
+        constexpr void reset() noexcept { m_value = niche::none(); }
+
+        constexpr bool has_value() const noexcept { return !niche::is_none(m_value); }
+
+        constexpr auto& value_unchecked(this auto& self) noexcept { return self.m_value; }
+
+    private:
+        T m_value;
+    };
+
     // Optional reference - (A safe pointer)
     // Doesn't take ownership
     template <typename Ty>
@@ -230,11 +429,11 @@ namespace gef {
     };
 
     // Optional unique_ref - (A safe std::unique_ptr)
-    // Takes ownership
-    template <typename Ty>
-    class option<unique_ref<Ty>> : public OptionMethods<unique_ref<Ty>> {
+    // Takes ownership. null is its niche, so it is pointer sized too (with a stateless `D`, e.g. `gef::pool<T>::ref`)
+    template <typename Ty, typename D>
+    class option<unique_ref<Ty, D>> : public OptionMethods<unique_ref<Ty, D>> {
     public:
-        using T = unique_ref<Ty>;
+        using T = unique_ref<Ty, D>;
 
         constexpr option() noexcept : m_value(nullptr) {}
 
@@ -246,7 +445,7 @@ namespace gef {
 
         constexpr option(nullopt_t) noexcept : m_value(nullptr) {}
 
-        constexpr option(std::unique_ptr<Ty>&& uqptr) noexcept :
+        constexpr option(std::unique_ptr<Ty, D>&& uqptr) noexcept :
             m_value(maybe_nullref, std::move(uqptr))
         {}
 
@@ -257,7 +456,7 @@ namespace gef {
 
         // ====
 
-        explicit constexpr operator std::unique_ptr<Ty>& () noexcept { return m_value._Ptr; }
+        explicit constexpr operator std::unique_ptr<Ty, D>& () noexcept { return m_value._Ptr; }
 
         template <typename ...Args>
             requires(std::constructible_from<T, Args...>)
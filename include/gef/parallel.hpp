@@ -0,0 +1,199 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <functional>
+#include <concepts>
+#include <memory>
+#include <type_traits>
+
+#include "better_types.hpp"
+
+namespace gef {
+
+	// Fixed set of worker threads, started once and reused by every `for_chunks` call.
+	// one job runs at a time: a call made while the pool is busy (from another thread, or nested inside a job)
+	// runs its chunks on the calling thread alone
+	class thread_pool {
+	public:
+
+		// `threads` workers, fewer if the system refuses to start more
+		explicit thread_pool(const size_t threads) noexcept {
+			m_threads.reserve(threads);
+
+			for (size_t t = 0; t < threads; ++t) {
+				try {
+					m_threads.emplace_back([this] { worker_loop(); });
+				}
+				catch (...) {
+					break;
+				}
+			}
+		}
+
+		thread_pool(const thread_pool&)            = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		~thread_pool() noexcept {
+			{
+				std::scoped_lock lock(m_mutex);
+				m_stop = true;
+			}
+
+			m_work.notify_all();
+		}
+
+		// one worker per hardware thread besides the caller, started on first use.
+		// intentionally leaked, jobs may still run during static destruction
+		static thread_pool& shared() noexcept {
+			static thread_pool& pool = *new thread_pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+			return pool;
+		}
+
+		constexpr size_t worker_count() const noexcept {
+			return m_threads.size();
+		}
+
+		// `f(begin, end)` over [0, count) in chunks of `grain`. chunks are claimed from a shared counter,
+		// so fast threads pick up the work of slow ones. the caller takes part and returns once every chunk is done
+		template <typename F>
+			requires(requires(F& f, size_t begin, size_t end) { { f(begin, end) } -> std::same_as<void>; })
+		void for_chunks(const size_t count, const size_t grain, F&& f) noexcept {
+
+			if (count == 0) {
+				return;
+			}
+
+			job j{
+				[](void* ctx, const size_t begin, const size_t end) { std::invoke(*static_cast<std::remove_reference_t<F>*>(ctx), begin, end); },
+				const_cast<void*>(static_cast<const void*>(std::addressof(f))),
+				count,
+				std::max<size_t>(grain, 1)
+			};
+
+			j.chunk_count = (count + j.chunk - 1) / j.chunk;
+
+			if (j.chunk_count == 1 || !publish(j)) {
+				j.work();
+				return;
+			}
+
+			j.work();
+
+			std::unique_lock lock(m_mutex);
+
+			m_done.wait(lock, [&] { return j.active == 0; });
+
+			m_job = nullptr;
+		}
+
+	private:
+
+		struct job {
+			void (*run)(void* ctx, size_t begin, size_t end);
+			void* ctx;
+
+			size_t count;
+			size_t chunk;
+			size_t chunk_count{ 0 };
+
+			std::atomic<size_t> next_chunk{ 0 };
+
+			// workers inside `work`, guarded by `m_mutex`
+			size_t active{ 0 };
+
+			void work() noexcept {
+				for (size_t c = next_chunk.fetch_add(1, std::memory_order_relaxed); c < chunk_count;
+					c = next_chunk.fetch_add(1, std::memory_order_relaxed))
+				{
+					const size_t begin = c * chunk;
+
+					run(ctx, begin, std::min(begin + chunk, count));
+				}
+			}
+		};
+
+		// false if there are no workers or another job is running
+		bool publish(job& j) noexcept {
+			{
+				std::scoped_lock lock(m_mutex);
+
+				if (m_threads.empty() || m_job != nullptr) {
+					return false;
+				}
+
+				m_job = &j;
+				++m_epoch;
+			}
+
+			m_work.notify_all();
+
+			return true;
+		}
+
+		void worker_loop() noexcept {
+			std::unique_lock lock(m_mutex);
+
+			u64 seen = 0;
+
+			while (true) {
+				m_work.wait(lock, [&] { return m_stop || m_epoch != seen; });
+
+				if (m_stop) {
+					return;
+				}
+
+				seen = m_epoch;
+
+				// woken after the job already finished
+				job* j = m_job;
+
+				if (j == nullptr) {
+					continue;
+				}
+
+				++j->active;
+
+				lock.unlock();
+				j->work();
+				lock.lock();
+
+				if (--j->active == 0) {
+					m_done.notify_all();
+				}
+			}
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_work;
+		std::condition_variable m_done;
+
+		job* m_job{ nullptr };
+		u64 m_epoch{ 0 };
+		bool m_stop{ false };
+
+		// last, so the workers are joined before the members they use go away
+		std::vector<std::jthread> m_threads;
+	};
+
+	// `grain` rounded up to whole cache lines of `T`, so two chunks of a line aligned array never share a line
+	template <typename T>
+	constexpr size_t cache_line_grain(const size_t grain) noexcept {
+		constexpr size_t per_line = std::max<size_t>(cache_line_size / sizeof(T), 1);
+
+		return (std::max<size_t>(grain, 1) + per_line - 1) / per_line * per_line;
+	}
+
+	// `thread_pool::for_chunks` on the shared pool
+	template <typename F>
+		requires(requires(F& f, size_t begin, size_t end) { { f(begin, end) } -> std::same_as<void>; })
+	void parallel_for_chunks(const size_t count, const size_t grain, F&& f) noexcept {
+		thread_pool::shared().for_chunks(count, grain, f);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <concepts>
+
+#include "better_types.hpp"
+#include "unique_ref.hpp"
+
+namespace gef {
+
+	template <typename T, size_t SlabSize> class pool;
+
+	// stateless, so a pooled `unique_ref` stays one pointer
+	template <typename T, size_t SlabSize>
+	struct pool_deleter {
+		void operator()(T* ptr) const noexcept {
+			pool<T, SlabSize>::destroy(ptr);
+		}
+	};
+
+	// Fixed-size object pool for `T`, one per type, shared by every thread.
+	//     gef::pool<job>::ref j = gef::pool<job>::make(args...);
+	//
+	// Blocks are carved out of slabs of `SlabSize` objects, so pooled objects live close together.
+	// Every thread keeps its own free list: `make` and the destruction of a `ref` are a plain pointer push / pop,
+	// the shared lock is only taken to move a batch of `SlabSize` blocks between a thread and the shared list.
+	// An object may be destroyed on any thread, its block joins that thread's free list. a list past `2 * SlabSize`
+	// blocks hands the surplus back, so objects made on one thread and destroyed on another keep getting reused.
+	//
+	// slabs are never freed, the pool only grows to its high-water mark. that also keeps
+	// pooled objects with static storage duration valid until the very end of the program
+	template <typename T, size_t SlabSize = 64>
+	class pool {
+		static_assert(SlabSize > 0);
+
+	public:
+
+		using deleter = pool_deleter<T, SlabSize>;
+		using ref     = unique_ref<T, deleter>;
+
+		pool() = delete;
+
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		static ref make(Args&&... args) noexcept {
+			block* b = pop();
+
+			return ref{ maybe_nullref, ::new (static_cast<void*>(b->storage)) T(std::forward<Args>(args)...), deleter{} };
+		}
+
+		// fills the calling thread's free list up to at least `count` blocks, so the next `count` makes don't lock
+		static void reserve(const size_t count) noexcept {
+			local_list& local = local_list::get();
+
+			// nothing would hand the list back anymore
+			if (local.exited) {
+				return;
+			}
+
+			while (local.count < count) {
+				refill(local);
+			}
+		}
+
+	private:
+		friend struct pool_deleter<T, SlabSize>;
+
+		union block {
+			block* next;
+			alignas(T) byte storage[sizeof(T)];
+		};
+
+		// a null terminated list of `count` blocks
+		struct batch {
+			block* head;
+			size_t count;
+		};
+
+		static constexpr size_t local_limit = 2 * SlabSize;
+
+		struct shared_state {
+			std::mutex mutex;
+			std::vector<block*> slabs;
+
+			// blocks handed back by threads with too many, or by exited threads
+			std::vector<batch> free_batches;
+		};
+
+		// trivially destructible, so it can still be used after the thread's `local_owner` is gone
+		// (objects destroyed during thread exit go to the shared list instead)
+		struct local_list {
+			block* head{ nullptr };
+			size_t count{ 0 };
+			bool exited{ false };
+
+			static local_list& get() noexcept {
+				thread_local local_list list;
+				thread_local local_owner owner;
+
+				return list;
+			}
+		};
+
+		// hands the thread's free list back when the thread exits
+		struct local_owner {
+			~local_owner() noexcept {
+				local_list& local = local_list::get();
+
+				give_back(local.head, local.count);
+
+				local.head   = nullptr;
+				local.count  = 0;
+				local.exited = true;
+			}
+		};
+
+		// intentionally leaked, objects may still be destroyed during static destruction
+		static shared_state& shared() noexcept {
+			static shared_state& state = *new shared_state;
+
+			return state;
+		}
+
+		static block* pop() noexcept {
+			local_list& local = local_list::get();
+
+			// made during thread exit: one block out of a batch, the rest goes straight back to the shared list
+			if (local.exited) {
+				local_list spare;
+
+				refill(spare);
+
+				block* b = spare.head;
+
+				give_back(b->next, spare.count - 1);
+
+				return b;
+			}
+
+			if (local.head == nullptr) {
+				refill(local);
+			}
+
+			block* b = local.head;
+
+			local.head = b->next;
+			local.count--;
+
+			return b;
+		}
+
+		static void destroy(T* ptr) noexcept {
+			ptr->~T();
+
+			block* b = reinterpret_cast<block*>(ptr);
+
+			local_list& local = local_list::get();
+
+			if (local.exited) {
+				b->next = nullptr;
+				give_back(b, 1);
+
+				return;
+			}
+
+			b->next    = local.head;
+			local.head = b;
+			local.count++;
+
+			if (local.count > local_limit) {
+				trim(local);
+			}
+		}
+
+		// keeps the `SlabSize` most recently freed blocks, the rest go to the shared list in one batch
+		static void trim(local_list& local) noexcept {
+			block* kept_tail = local.head;
+
+			for (size_t i = 1; i < SlabSize; ++i) {
+				kept_tail = kept_tail->next;
+			}
+
+			give_back(std::exchange(kept_tail->next, nullptr), local.count - SlabSize);
+
+			local.count = SlabSize;
+		}
+
+		// takes a batch off the shared list if there is one, otherwise a new slab
+		static void refill(local_list& local) noexcept {
+			shared_state& state = shared();
+
+			std::unique_lock lock{ state.mutex };
+
+			if (!state.free_batches.empty()) {
+				const batch taken = state.free_batches.back();
+
+				state.free_batches.pop_back();
+
+				lock.unlock();
+
+				// only `reserve` refills a non-empty list
+				if (local.head != nullptr) {
+					block* tail = taken.head;
+
+					while (tail->next != nullptr) {
+						tail = tail->next;
+					}
+
+					tail->next = local.head;
+				}
+
+				local.head = taken.head;
+				local.count += taken.count;
+
+				return;
+			}
+
+			block* slab = static_cast<block*>(::operator new(sizeof(block) * SlabSize, std::align_val_t{ alignof(block) }));
+
+			state.slabs.push_back(slab);
+
+			for (size_t i = 0; i < SlabSize; ++i) {
+				slab[i].next = i + 1 < SlabSize ? &slab[i + 1] : local.head;
+			}
+
+			local.head = slab;
+			local.count += SlabSize;
+		}
+
+		// `head` is a null terminated list of `count` blocks
+		static void give_back(block* head, const size_t count) noexcept {
+			if (head == nullptr) {
+				return;
+			}
+
+			shared_state& state = shared();
+
+			std::scoped_lock lock{ state.mutex };
+
+			state.free_batches.push_back(batch{ head, count });
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <span>
+#include <bit>
+#include <thread>
+#include <algorithm>
+
+#include "better_types.hpp"
+
+namespace gef {
+
+	// Lock-free single-producer / single-consumer byte ring.
+	// Exactly one thread may write and exactly one thread may read at a time.
+	//
+	// The write and read cursors live on separate cache lines, and each side caches the other side's cursor,
+	// so the shared lines are only touched when the cached value says the ring looks full (or empty)
+	class ring_byte_buffer {
+	public:
+
+		// `min_capacity` is rounded up to a power of two
+		explicit ring_byte_buffer(const size_t min_capacity) noexcept :
+			m_capacity(std::bit_ceil(std::max<size_t>(min_capacity, 1))),
+			m_buffer(std::make_unique_for_overwrite<byte[]>(m_capacity))
+		{}
+
+		ring_byte_buffer(const ring_byte_buffer&)            = delete;
+		ring_byte_buffer& operator=(const ring_byte_buffer&) = delete;
+
+		// ==== producer
+
+		// all or nothing. false if there is not enough free space
+		bool try_write(std::span<const byte> data) noexcept {
+			const size_t n    = data.size();
+			const size_t head = m_head.load(std::memory_order_relaxed);
+
+			if (m_capacity - (head - m_cached_tail) < n) {
+				m_cached_tail = m_tail.load(std::memory_order_acquire);
+
+				if (m_capacity - (head - m_cached_tail) < n) {
+					return false;
+				}
+			}
+
+			const size_t offset = head & (m_capacity - 1);
+			const size_t first  = std::min(n, m_capacity - offset);
+
+			std::memcpy(m_buffer.get() + offset, data.data(), first);
+			std::memcpy(m_buffer.get(), data.data() + first, n - first);
+
+			m_head.store(head + n, std::memory_order_release);
+
+			return true;
+		}
+
+		// waits until `data` fits. `data.size()` must not exceed `capacity()`
+		void write(std::span<const byte> data) noexcept {
+			for (size_t spins = 0; !try_write(data); ++spins) {
+				backoff(spins);
+			}
+		}
+
+		// ==== consumer
+
+		// all or nothing. false if fewer than `out.size()` bytes are readable
+		bool try_read(std::span<byte> out) noexcept {
+			const size_t n    = out.size();
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+			if (m_cached_head - tail < n) {
+				m_cached_head = m_head.load(std::memory_order_acquire);
+
+				if (m_cached_head - tail < n) {
+					return false;
+				}
+			}
+
+			const size_t offset = tail & (m_capacity - 1);
+			const size_t first  = std::min(n, m_capacity - offset);
+
+			std::memcpy(out.data(), m_buffer.get() + offset, first);
+			std::memcpy(out.data() + first, m_buffer.get(), n - first);
+
+			m_tail.store(tail + n, std::memory_order_release);
+
+			return true;
+		}
+
+		// waits until `out` is filled. `out.size()` must not exceed `capacity()`
+		void read(std::span<byte> out) noexcept {
+			for (size_t spins = 0; !try_read(out); ++spins) {
+				backoff(spins);
+			}
+		}
+
+		// ====
+
+		constexpr size_t capacity() const noexcept {
+			return m_capacity;
+		}
+
+		// exact only when called by the producer or the consumer while the other side is idle
+		size_t size() const noexcept {
+			return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+		}
+
+	private:
+
+		// spin first, the other side is usually only a few hundred cycles behind
+		static void backoff(const size_t spins) noexcept {
+			if (spins >= 64) {
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+		// read-only after construction
+		const size_t m_capacity;
+		const std::unique_ptr<byte[]> m_buffer;
+
+		// producer line
+		alignas(cache_line_size) std::atomic<size_t> m_head{ 0 };
+		size_t m_cached_tail{ 0 };
+
+		// consumer line
+		alignas(cache_line_size) std::atomic<size_t> m_tail{ 0 };
+		size_t m_cached_head{ 0 };
+	};
+}
\ No newline at end of file
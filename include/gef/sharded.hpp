@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <unordered_map>
+#include <functional>
+#include <shared_mutex>
+#include <type_traits>
+#include <concepts>
+
+#include "better_types.hpp"
+#include "option.hpp"
+#include "mutex_guard.hpp"
+
+
+namespace gef {
+
+    // `N` independent `gef::mutex<T>`, each on its own cache lines. A key always maps to the same shard,
+    // so threads working on different keys rarely share a lock:
+    //     gef::sharded<std::vector<job>> queues;
+    //     queues.lock(worker_id, [&](auto& q) { q.push_back(j); });
+    template <class T, size_t N = 64, class Lockable = std::shared_mutex>
+    class sharded {
+        static_assert(std::has_single_bit(N), "shard count must be a power of two");
+
+    public:
+
+        static constexpr size_t shard_count = N;
+
+        template <typename Key, typename Hash = std::hash<Key>, typename F>
+            requires(requires(F&& f, T& v) { { f(v) }; })
+        constexpr auto lock(const Key& key, F&& f, const Hash& hash = {}) noexcept {
+            return shard_for(hash(key)).lock(std::forward<F>(f));
+        }
+
+        template <typename Key, typename Hash = std::hash<Key>, typename F>
+            requires(requires(F&& f, T& v) { { f(v) }; })
+        constexpr auto shared_lock(const Key& key, F&& f, const Hash& hash = {}) noexcept {
+            return shard_for(hash(key)).shared_lock(std::forward<F>(f));
+        }
+
+        // locks the shards one after another, never more than one at a time
+        template <typename F>
+            requires(requires(F& f, T& v) { { f(v) }; })
+        constexpr void for_each_shard(F&& f) noexcept {
+            for (shard& s : m_shards) {
+                s.value.lock(f);
+            }
+        }
+
+        template <typename F>
+            requires(requires(F& f, T& v) { { f(v) }; })
+        constexpr void shared_for_each_shard(F&& f) noexcept {
+            for (shard& s : m_shards) {
+                s.value.shared_lock(f);
+            }
+        }
+
+        constexpr mutex<T, Lockable>& shard_at(const size_t index) noexcept {
+            return m_shards[index].value;
+        }
+
+        // the shard `hash` belongs to
+        constexpr mutex<T, Lockable>& shard_for(const size_t hash) noexcept {
+            if constexpr (N == 1) {
+                return m_shards[0].value;
+            }
+            else {
+                // fibonacci hashing, takes the high bits so the shard doesn't follow
+                // the low bits a hash table inside the shard picks its bucket with
+                const u64 mixed = static_cast<u64>(hash) * 0x9E3779B97F4A7C15ull;
+
+                return m_shards[mixed >> (64 - std::countr_zero(N))].value;
+            }
+        }
+
+    private:
+        struct alignas(cache_line_size) shard {
+            mutex<T, Lockable> value;
+        };
+
+        std::array<shard, N> m_shards;
+    };
+
+    // `std::unordered_map` split over `N` shards. Every call locks only the shard of its key
+    template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>, size_t N = 64>
+    class concurrent_map {
+    public:
+
+        using map_type = std::unordered_map<K, V, Hash, KeyEqual>;
+
+        // `f(V&)` under an exclusive lock, the value is default constructed if missing
+        template <typename F>
+            requires(std::default_initializable<V> && requires(F&& f, V& v) { { f(v) }; })
+        constexpr auto lock(const K& key, F&& f) noexcept {
+            return m_shards.lock(key, [&](map_type& map) {
+                return std::invoke(std::forward<F>(f), map.try_emplace(key).first->second);
+            }, m_hash);
+        }
+
+        // `f(const V&)` under a shared lock, false if `key` is missing
+        template <typename F>
+            requires(requires(F&& f, const V& v) { { f(v) } -> std::same_as<void>; })
+        constexpr bool shared_lock(const K& key, F&& f) noexcept {
+            return m_shards.shared_lock(key, [&](const map_type& map) {
+                const auto it = map.find(key);
+
+                if (it == map.end()) {
+                    return false;
+                }
+
+                std::invoke(std::forward<F>(f), it->second);
+
+                return true;
+            }, m_hash);
+        }
+
+        // a copy of the value
+        constexpr gef::option<V> get(const K& key) noexcept
+            requires(std::copy_constructible<V>)
+        {
+            return m_shards.shared_lock(key, [&](const map_type& map) -> gef::option<V> {
+                const auto it = map.find(key);
+
+                if (it == map.end()) {
+                    return gef::nullopt;
+                }
+
+                return gef::option<V>{ it->second };
+            }, m_hash);
+        }
+
+        // false if `key` was already there, the existing value is kept
+        template <typename ...Args>
+            requires(std::constructible_from<V, Args...>)
+        constexpr bool emplace(const K& key, Args&&... args) noexcept {
+            return m_shards.lock(key, [&](map_type& map) {
+                return map.try_emplace(key, std::forward<Args>(args)...).second;
+            }, m_hash);
+        }
+
+        constexpr bool erase(const K& key) noexcept {
+            return m_shards.lock(key, [&](map_type& map) { return map.erase(key) != 0; }, m_hash);
+        }
+
+        constexpr bool contains(const K& key) noexcept {
+            return m_shards.shared_lock(key, [&](const map_type& map) { return map.contains(key); }, m_hash);
+        }
+
+        // `f(const K&, V&)`, one shard locked at a time. not a snapshot: other shards change meanwhile
+        template <typename F>
+            requires(requires(F& f, const K& k, V& v) { { f(k, v) }; })
+        constexpr void for_each(F&& f) noexcept {
+            m_shards.for_each_shard([&](map_type& map) {
+                for (auto& [key, value] : map) {
+                    std::invoke(f, key, value);
+                }
+            });
+        }
+
+        // sum of the shard sizes, not a snapshot either
+        constexpr size_t size() noexcept {
+            size_t total = 0;
+
+            m_shards.shared_for_each_shard([&](const map_type& map) { total += map.size(); });
+
+            return total;
+        }
+
+        constexpr void clear() noexcept {
+            m_shards.for_each_shard([](map_type& map) { map.clear(); });
+        }
+
+    private:
+        sharded<map_type, N> m_shards;
+
+        [[no_unique_address]] Hash m_hash;
+    };
+}
\ No newline at end of file
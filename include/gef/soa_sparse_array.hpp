@@ -0,0 +1,222 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <span>
+#include <memory>
+#include <memory_resource>
+
+#include "better_types.hpp"
+#include "option.hpp"
+#include "sparse_storage.hpp"
+#include "sparse_slots.hpp"
+
+namespace gef {
+
+	// Structure-of-arrays `gef::sparse_array`: one column per field, all sharing the same slots.
+	// A pass that touches one field only streams that column.
+	//
+	// `for_each`, `parallel_for_each` and `erase_if` take the columns to project as template arguments:
+	//     particles.for_each<0, 2>([](vec3& pos, float& hp, size_t& i) { ... });
+	// no arguments means every column
+	//
+	// `Allocator` is rebound for every column and the bookkeeping, see `gef::soa_sparse_array` for the default one
+	template <typename Allocator, typename ...Fields>
+	class basic_soa_sparse_array : public basic_sparse_slots<rebind_alloc<Allocator, size_t>> {
+		using slots = basic_sparse_slots<rebind_alloc<Allocator, size_t>>;
+
+	public:
+
+		using allocator_type = Allocator;
+
+		using slots::alive_vec;
+		using slots::contains;
+		using slots::parallel_for_each_chunk;
+
+		template <size_t I>
+		using field_t = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+		std::tuple<bitset_storage<Fields, rebind_alloc<Allocator, Fields>>...> columns;
+
+	public:
+
+		basic_soa_sparse_array() noexcept {}
+
+		basic_soa_sparse_array(const size_t size) noexcept {
+			resize(size);
+		}
+
+		explicit basic_soa_sparse_array(const Allocator& alloc) noexcept :
+			slots(alloc),
+			columns(rebind_alloc<Allocator, Fields>(alloc)...)
+		{}
+
+		basic_soa_sparse_array(const size_t size, const Allocator& alloc) noexcept :
+			basic_soa_sparse_array(alloc)
+		{
+			resize(size);
+		}
+
+	public:
+
+		constexpr void resize(const size_t new_capacity) noexcept {
+			std::apply([&](auto&... column) { (column.resize(new_capacity), ...); }, columns);
+
+			this->resize_slots(new_capacity);
+		}
+
+		template <size_t I>
+		constexpr auto& column(this auto& self) noexcept {
+			return std::get<I>(self.columns);
+		}
+
+		template <size_t I>
+		constexpr field_t<I>& at(this auto& self, const size_t index) noexcept {
+			return std::get<I>(self.columns).value_unchecked(index);
+		}
+
+		// one argument per field
+		template <typename ...Args>
+			requires(sizeof...(Args) == sizeof...(Fields) && (std::constructible_from<Fields, Args> && ...))
+		constexpr std::tuple<Fields&...> emplace_at(const size_t index, Args&&... fields) noexcept {
+
+			this->insert_slot(index);
+
+			return set_columns(index, std::index_sequence_for<Fields...>{}, std::forward<Args>(fields)...);
+		}
+
+		// construct in an empty slot, and return its index. nullopt if full
+		template <typename ...Args>
+			requires(sizeof...(Args) == sizeof...(Fields) && (std::constructible_from<Fields, Args> && ...))
+		constexpr gef::option<size_t> emplace(Args&&... fields) noexcept {
+
+			gef::option<size_t> index = this->take_empty_index();
+
+			if (index.has_value()) {
+				emplace_at(index.value_unchecked(), std::forward<Args>(fields)...);
+			}
+
+			return index;
+		}
+
+		// O(1), swaps the last alive index into the erased position
+		constexpr void erase_at(const size_t index) noexcept {
+
+			if (this->erase_slot(index)) {
+				reset_columns(index);
+			}
+		}
+
+		constexpr void erase(const sparse_handle handle) noexcept {
+			if (contains(handle)) {
+				erase_at(handle.index());
+			}
+		}
+
+		// `f(fields...)` on the projected columns of one row, recorded as a change when `track_changes` is set
+		template <size_t ...Is, typename F>
+		constexpr decltype(auto) modify(const size_t index, F&& f) noexcept {
+
+			this->mark_modified(index);
+
+			return invoke_projected<Is...>(f, index);
+		}
+
+		// `f(fields..., index)`
+		template <size_t ...Is, typename F>
+		constexpr void for_each(F&& f) noexcept {
+
+			this->prepare_iteration();
+
+			for (size_t& index : alive_vec) {
+				invoke_projected<Is...>(f, index, index);
+			}
+		}
+
+		// `for_each` spread over threads, `f` is called concurrently
+		template <size_t ...Is, typename F>
+		void parallel_for_each(F&& f, const size_t grain = 4096) noexcept {
+
+			parallel_for_each_chunk(
+				[&](std::span<const size_t> chunk) {
+					for (const size_t index : chunk) {
+						invoke_projected<Is...>(f, index, index);
+					}
+				},
+				grain);
+		}
+
+		// `f(fields...) -> bool`. single pass, keeps the relative order of the remaining indices
+		template <size_t ...Is, typename F>
+		constexpr void erase_if(F&& f) noexcept {
+
+			this->erase_slots_if([&](const size_t index) {
+				if (invoke_projected<Is...>(f, index)) {
+					reset_columns(index);
+
+					return true;
+				}
+
+				return false;
+			});
+		}
+
+		// defragments the rows into [0, size()), returns old slot -> new slot (`npos` where empty).
+		// handles to moved rows go stale
+		constexpr typename slots::index_vector compact() noexcept {
+
+			return this->compact_slots([&](const size_t from, const size_t to) {
+				std::apply([&](auto&... column) {
+					((column.set(to, std::move(column.value_unchecked(from))), column.reset(from)), ...);
+				}, columns);
+			});
+		}
+
+		// Invalidates all data
+		constexpr void clear() noexcept {
+
+			for (const size_t index : alive_vec) {
+				reset_columns(index);
+			}
+
+			this->clear_slots();
+		}
+
+	private:
+
+		template <size_t ...Is, typename ...Args>
+		constexpr std::tuple<Fields&...> set_columns(const size_t index, std::index_sequence<Is...>, Args&&... fields) noexcept {
+			// braced init, columns are set in order
+			return std::tuple<Fields&...>{ std::get<Is>(columns).set(index, std::forward<Args>(fields))... };
+		}
+
+		constexpr void reset_columns(const size_t index) noexcept {
+			std::apply([&](auto&... column) { (column.reset(index), ...); }, columns);
+		}
+
+		// calls `f` with the projected columns at `index`, followed by `extra`
+		template <size_t ...Is, typename F, typename ...Extra>
+		constexpr decltype(auto) invoke_projected(F& f, const size_t index, Extra&... extra) noexcept {
+			if constexpr (sizeof...(Is) == 0) {
+				return invoke_columns(f, index, std::index_sequence_for<Fields...>{}, extra...);
+			}
+			else {
+				return invoke_columns(f, index, std::index_sequence<Is...>{}, extra...);
+			}
+		}
+
+		template <typename F, size_t ...Is, typename ...Extra>
+			requires(std::invocable<F&, field_t<Is>&..., Extra&...>)
+		constexpr decltype(auto) invoke_columns(F& f, const size_t index, std::index_sequence<Is...>, Extra&... extra) noexcept {
+			return std::invoke(f, at<Is>(index)..., extra...);
+		}
+	};
+
+	template <typename ...Fields>
+	using soa_sparse_array = basic_soa_sparse_array<std::allocator<std::byte>, Fields...>;
+
+	namespace pmr {
+		template <typename ...Fields>
+		using soa_sparse_array = basic_soa_sparse_array<std::pmr::polymorphic_allocator<std::byte>, Fields...>;
+	}
+}
\ No newline at end of file
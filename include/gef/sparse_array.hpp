@@ -1,20 +1,50 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <shared_mutex>
 #include <span>
+#include <ranges>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+#include <memory_resource>
 
 #include "better_types.hpp"
 #include "option.hpp"
+#include "sparse_storage.hpp"
+#include "sparse_slots.hpp"
+#include "byte_buffer.hpp"
 
 namespace gef {
 
-	template <typename T>
-	class sparse_array {
+	// Iteration order over `alive_vec` is unspecified (unstable):
+	// `erase_at` moves the last alive index into the erased position,
+	// `erase_if` keeps the relative order of the remaining indices
+	//
+	// `Storage` picks the slot layout and the allocator, see sparse_storage.hpp
+	template <typename T, typename Storage = option_storage<T>>
+	class sparse_array : public basic_sparse_slots<rebind_alloc<typename Storage::allocator_type, size_t>> {
+		using slots = basic_sparse_slots<rebind_alloc<typename Storage::allocator_type, size_t>>;
+
 	public:
+
+		using allocator_type = typename Storage::allocator_type;
+
+		// snapshot format, all little-endian:
+		//     u32 magic, u32 version, u32 sizeof(T), u32 alignof(T), u64 capacity, u64 size
+		//     occupancy: ceil(capacity / 64) u64 words, bit `i % 64` of word `i / 64` set for alive slots
+		//     the alive values in ascending slot order, densely packed, as the raw bytes of `T`
+		// the values are not byte swapped, snapshots only move between hosts sharing the layout of `T`
+		static constexpr u32 snapshot_magic   = 0x53464547; // "GEFS"
+		static constexpr u32 snapshot_version = 1;
+
+		using slots::alive_vec;
+		using slots::contains;
+		using slots::parallel_for_each_chunk;
 		
-		std::vector<gef::option<T>> data_vec;
-		std::vector<size_t> alive_vec;
+		Storage data_vec;
 
 	public:
 
@@ -24,15 +54,27 @@ namespace gef {
 			resize(size);
 		}
 
+		explicit sparse_array(const allocator_type& alloc) noexcept :
+			slots(alloc),
+			data_vec(alloc)
+		{}
+
+		sparse_array(const size_t size, const allocator_type& alloc) noexcept :
+			slots(alloc),
+			data_vec(alloc)
+		{
+			resize(size);
+		}
+
 	public:
 
 		constexpr void resize(const size_t new_capacity) noexcept {
 			data_vec.resize(new_capacity);
-			alive_vec.reserve(new_capacity);
+			this->resize_slots(new_capacity);
 		}
 
 		constexpr T& at(this auto& self, const size_t index) noexcept {
-			return self.data_vec[index].value_unchecked();
+			return self.data_vec.value_unchecked(index);
 		}
 
 		constexpr T& operator[](this auto& self, const size_t index) noexcept {
@@ -43,66 +85,173 @@ namespace gef {
 			requires(std::constructible_from<T, Args...>)
 		constexpr T& emplace_at(const size_t index, Args&&... args) noexcept {
 
-			alive_vec.emplace_back(index);
+			this->insert_slot(index);
+
+			return data_vec.set(index, std::forward<Args>(args)...);
+		}
+
+		// construct in an empty slot, and return its index. nullopt if full
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr gef::option<size_t> emplace(Args&&... args) noexcept {
+
+			gef::option<size_t> index = this->take_empty_index();
+
+			if (index.has_value()) {
+				emplace_at(index.value_unchecked(), std::forward<Args>(args)...);
+			}
 
-			return data_vec[index].set(std::forward<Args>(args)...);
+			return index;
 		}
 
-		constexpr gef::option<size_t> next_empty_index() noexcept {
+		// bulk `emplace_at`: `values[i]` is constructed at `indices[i]`, slots already alive are overwritten.
+		// grows the array once to fit the largest index. false, and nothing emplaced, if `values` is shorter than `indices`
+		template <std::ranges::input_range R>
+			requires(std::ranges::sized_range<R> && std::constructible_from<T, std::ranges::range_reference_t<R>>)
+		constexpr bool emplace_range(std::span<const size_t> indices, R&& values) noexcept {
 
-			if (size() == capacity()) {
-				return gef::nullopt;
+			if (static_cast<size_t>(std::ranges::size(values)) < indices.size()) {
+				return false;
+			}
+
+			if (indices.empty()) {
+				return true;
+			}
+
+			if (const size_t last = std::ranges::max(indices); last >= this->capacity()) {
+				grow(last + 1);
 			}
 
-			for (auto& item : data_vec) {
-				if (item.is_null()) {
-					return &item - &data_vec[0];
+			alive_vec.reserve(this->size() + indices.size());
+
+			auto value = std::ranges::begin(values);
+
+			for (const size_t index : indices) {
+				if (this->insert_slot(index)) {
+					data_vec.construct(index, *value);
+				}
+				else {
+					data_vec.set(index, *value);
 				}
+
+				++value;
 			}
 
-			return gef::nullopt;
+			return true;
+		}
+
+		// constructs `gen(index)` in `count` empty slots, growing the array once if they don't fit
+		template <typename F>
+			requires(std::constructible_from<T, std::invoke_result_t<F&, size_t>>)
+		constexpr void append_n(const size_t count, F&& gen) noexcept {
+
+			if (this->capacity() - this->size() < count) {
+				grow(this->size() + count);
+			}
+
+			for (size_t i = 0; i < count; ++i) {
+				const size_t index = this->take_empty_index().value_unchecked();
+
+				this->insert_slot(index);
+
+				data_vec.construct(index, std::invoke(gen, index));
+			}
 		}
 
+		// O(1), swaps the last alive index into the erased position
 		constexpr void erase_at(const size_t index) noexcept {
 
-			for (size_t& s : alive_vec) {
-				if (s == index) {
-					alive_vec.erase(alive_vec.begin() + (&s - &alive_vec[0]));
-				}
+			if (this->erase_slot(index)) {
+				data_vec.reset(index);
 			}
+		}
+
+		// erases every alive index of `indices` in O(size() + indices.size()), see `erase_slots`.
+		// returns how many were erased
+		constexpr size_t erase_many(std::span<const size_t> indices) noexcept {
 
-			data_vec[index].reset();
+			return this->erase_slots(indices, [&](const size_t index) {
+				data_vec.reset(index);
+			});
 		}
 
+		// single pass, keeps the relative order of the remaining indices
 		template <typename F>
 			requires(requires(F&& f, T& v) { { f(v) }; })
 		constexpr void erase_if(F&& f) noexcept {
 
-			std::erase_if(alive_vec,
-				[&](size_t& index) {
-					if (std::invoke(std::forward<F>(f), at(index))) {
-						data_vec[index].reset();
+			this->erase_slots_if([&](const size_t index) {
+				if (std::invoke(f, at(index))) {
+					data_vec.reset(index);
 
-						return true;
-					}
+					return true;
+				}
 
-					return false;
-				});
+				return false;
+			});
+		}
+
+		// `f(value)`, recorded as a change when `track_changes` is set
+		template <typename F>
+			requires(requires(F&& f, T& v) { { f(v) }; })
+		constexpr decltype(auto) modify(const size_t index, F&& f) noexcept {
+
+			this->mark_modified(index);
+
+			return std::invoke(std::forward<F>(f), at(index));
+		}
+
+		// O(1), nullopt if the handle is stale. `option<T const&>` through a const array
+		template <typename Self>
+		constexpr auto get(this Self& self, const sparse_handle handle) noexcept
+			-> gef::option<std::conditional_t<std::is_const_v<Self>, T const&, T&>>
+		{
+			if (self.contains(handle)) {
+				return self.data_vec.value_unchecked(handle.index());
+			}
+
+			return gef::nullopt;
+		}
+
+		constexpr void erase(const sparse_handle handle) noexcept {
+			if (contains(handle)) {
+				erase_at(handle.index());
+			}
 		}
 
 		template <typename F>
 			requires(requires(F&& f, T& v, size_t& i) { { f(v, i) } -> std::same_as<void>; })
 		constexpr void for_each(F&& f) noexcept {
 
+			this->prepare_iteration();
+
 			for (size_t& index : alive_vec) {
 				std::invoke(std::forward<F>(f), at(index), index);
 			}
 		}
 
+		// `for_each` spread over threads, see `parallel_for_each_chunk`. `f` is called concurrently.
+		// `grain` is also rounded to whole cache lines of `T`: with `sorted_iteration` and dense slots,
+		// neighbouring chunks then write to different lines of a contiguous storage
+		template <typename F>
+			requires(requires(F& f, T& v, size_t i) { { f(v, i) } -> std::same_as<void>; })
+		void parallel_for_each(F&& f, const size_t grain = 4096) noexcept {
+
+			parallel_for_each_chunk(
+				[&](std::span<const size_t> chunk) {
+					for (const size_t index : chunk) {
+						std::invoke(f, at(index), index);
+					}
+				},
+				cache_line_grain<T>(grain));
+		}
+
 		template <typename F>
 			requires(requires(F&& f, T& v) { { f(v) } -> std::same_as<bool>; })
 		constexpr gef::option<T&> first_if(F&& f) noexcept {
 
+			this->prepare_iteration();
+
 			for (size_t& index : alive_vec) {
 				if (std::invoke(std::forward<F>(f), at(index))) {
 					return at(index);
@@ -112,23 +261,309 @@ namespace gef {
 			return gef::nullopt;
 		}
 
+		// ==== scalar search
+		// with `gef::bitset_storage` and a scalar `T` these run `pred` over the value buffer a mask word at a time
+		// (see `bitset_storage::match_word`) instead of one value at a time through `alive_vec`
+
+		// lowest alive index whose value satisfies `pred`
+		template <typename P>
+			requires(std::predicate<P&, const T&>)
+		constexpr gef::option<size_t> find_first(P&& pred) noexcept {
+
+			if constexpr (searchable_storage) {
+				for (size_t w = 0; w < data_vec.mask().size(); ++w) {
+					if (const u64 bits = data_vec.match_word(w, pred); bits != 0) {
+						return w * 64 + std::countr_zero(bits);
+					}
+				}
+
+				return gef::nullopt;
+			}
+			else {
+				size_t found = slots::npos;
+
+				for (const size_t index : alive_vec) {
+					if (index < found && std::invoke(pred, std::as_const(at(index)))) {
+						found = index;
+					}
+				}
+
+				if (found != slots::npos) {
+					return found;
+				}
+
+				return gef::nullopt;
+			}
+		}
+
+		template <typename P>
+			requires(std::predicate<P&, const T&>)
+		constexpr size_t count_if(P&& pred) noexcept {
+
+			size_t count = 0;
+
+			if constexpr (searchable_storage) {
+				for (size_t w = 0; w < data_vec.mask().size(); ++w) {
+					count += std::popcount(data_vec.match_word(w, pred));
+				}
+			}
+			else {
+				for (const size_t index : alive_vec) {
+					count += static_cast<bool>(std::invoke(pred, std::as_const(at(index))));
+				}
+			}
+
+			return count;
+		}
+
+		// `erase_if` for predicates on the value alone, keeps the relative order of the remaining indices.
+		// returns how many were erased
+		template <typename P>
+			requires(std::predicate<P&, const T&>)
+		constexpr size_t erase_where(P&& pred) noexcept {
+
+			if constexpr (searchable_storage) {
+				// scratch mask from the container's allocator, so pmr arrays don't reach the default heap
+				std::vector<u64, rebind_alloc<allocator_type, u64>> matched(data_vec.mask().size(), 0, alive_vec.get_allocator());
+
+				size_t count = 0;
+
+				for (size_t w = 0; w < matched.size(); ++w) {
+					matched[w] = data_vec.match_word(w, pred);
+					count     += std::popcount(matched[w]);
+				}
+
+				if (count != 0) {
+					this->erase_slots_if([&](const size_t index) {
+						if ((matched[index / 64] >> (index % 64)) & 1) {
+							data_vec.reset(index);
+
+							return true;
+						}
+
+						return false;
+					});
+				}
+
+				return count;
+			}
+			else {
+				const size_t before = this->size();
+
+				erase_if([&](const T& value) { return static_cast<bool>(std::invoke(pred, value)); });
+
+				return before - this->size();
+			}
+		}
+
+		// defragments the values into [0, size()), returns old slot -> new slot (`npos` where empty).
+		// handles to moved values go stale
+		constexpr typename slots::index_vector compact() noexcept {
+
+			return this->compact_slots([&](const size_t from, const size_t to) {
+				data_vec.set(to, std::move(at(from)));
+				data_vec.reset(from);
+			});
+		}
+
 		// Invalidates all data
 		constexpr void clear() noexcept {
 
-			alive_vec.clear();
+			for (const size_t index : alive_vec) {
+				data_vec.reset(index);
+			}
+
+			this->clear_slots();
+		}
+
+		// ==== snapshots
+
+		// appends a snapshot (see `snapshot_magic`). runs of adjacent alive slots are copied with one memcpy
+		// when the storage is contiguous (`gef::bitset_storage`)
+		void serialize(byte_buffer& out) const noexcept
+			requires(std::is_trivially_copyable_v<T>)
+		{
+			const size_t capacity = this->capacity();
+
+			std::vector<u64> words((capacity + 63) / 64, 0);
+
+			for (const size_t index : alive_vec) {
+				words[index / 64] |= u64{ 1 } << (index % 64);
+			}
+
+			out.write_le<u32>(snapshot_magic);
+			out.write_le<u32>(snapshot_version);
+			out.write_le<u32>(sizeof(T));
+			out.write_le<u32>(alignof(T));
+			out.write_le<u64>(capacity);
+			out.write_le<u64>(this->size());
+
+			if (!words.empty()) {
+				out.write_le(std::span<const u64>{ words });
+			}
+
+			const size_t bytes = this->size() * sizeof(T);
+
+			out.reserve_writable(bytes);
+
+			byte* dst = out.writable().data();
+
+			for_each_run(words, [&](const size_t first, const size_t count) {
+				if constexpr (contiguous_storage) {
+					std::memcpy(dst, &data_vec.value_unchecked(first), count * sizeof(T));
+				}
+				else {
+					for (size_t index = first; index < first + count; ++index) {
+						std::memcpy(dst + (index - first) * sizeof(T), &data_vec.value_unchecked(index), sizeof(T));
+					}
+				}
+
+				dst += count * sizeof(T);
+			});
+
+			out.commit(bytes);
+		}
+
+		// replaces the contents with a snapshot read from the front of `in`, and consumes it.
+		// all or nothing: false (`in` and the array untouched) on a wrong magic, version or layout, or truncated input.
+		// values are copied straight out of `in`, so a `map_file`d buffer loads without an intermediate read
+		bool deserialize(byte_buffer& in) noexcept
+			requires(std::is_trivially_copyable_v<T>)
+		{
+			const std::span<const byte> src = std::as_const(in).readable();
+
+			constexpr size_t header_size = 32;
+
+			if (src.size() < header_size ||
+				gef::load_le<u32>(src.data()) != snapshot_magic || gef::load_le<u32>(src.data() + 4) != snapshot_version ||
+				gef::load_le<u32>(src.data() + 8) != sizeof(T) || gef::load_le<u32>(src.data() + 12) != alignof(T))
+			{
+				return false;
+			}
+
+			const u64 capacity = gef::load_le<u64>(src.data() + 16);
+			const u64 count    = gef::load_le<u64>(src.data() + 24);
 
-			for (auto& opt : data_vec) {
-				opt.reset();
+			const size_t rest = src.size() - header_size;
+			const u64 word_count = capacity / 64 + (capacity % 64 != 0);
+
+			// checked in this order so nothing overflows
+			if (word_count > rest / 8 || count > capacity || count > (rest - word_count * 8) / sizeof(T)) {
+				return false;
+			}
+
+			std::vector<u64> words(word_count);
+
+			size_t alive = 0;
+
+			for (size_t w = 0; w < word_count; ++w) {
+				words[w] = gef::load_le<u64>(src.data() + header_size + w * 8);
+				alive += std::popcount(words[w]);
 			}
+
+			// bits past the capacity must be clear
+			if (alive != count || (capacity % 64 != 0 && (words.back() >> (capacity % 64)) != 0)) {
+				return false;
+			}
+
+			clear();
+			resize(capacity);
+
+			const byte* values = src.data() + header_size + word_count * 8;
+
+			for_each_run(words, [&](const size_t first, const size_t run) {
+				for (size_t index = first; index < first + run; ++index) {
+					this->insert_slot(index);
+				}
+
+				if constexpr (contiguous_storage) {
+					data_vec.construct_run(first, run, values);
+				}
+				else {
+					for (size_t i = 0; i < run; ++i) {
+						std::array<std::byte, sizeof(T)> raw;
+
+						std::memcpy(raw.data(), values + i * sizeof(T), sizeof(T));
+
+						data_vec.construct(first + i, std::bit_cast<T>(raw));
+					}
+				}
+
+				values += run * sizeof(T);
+			});
+
+			this->rebuild_free_list();
+
+			in.consume(header_size + word_count * 8 + count * sizeof(T));
+
+			return true;
 		}
 
-		constexpr size_t capacity() const noexcept {
-			return alive_vec.capacity();
+	private:
+
+		// at least doubles the capacity, so repeated bulk inserts stay amortized O(1) per value
+		constexpr void grow(const size_t min_capacity) noexcept {
+			resize(std::max(min_capacity, this->capacity() * 2));
 		}
 
-		constexpr size_t size() const noexcept {
-			return alive_vec.size();
+		static constexpr bool contiguous_storage = requires(Storage& s, const void* src) { s.construct_run(0, 0, src); };
+
+		static constexpr bool searchable_storage = requires(Storage const& s, bool(&pred)(const T&)) { s.match_word(0, pred); };
+
+		// `f(first, count)` for every run of set bits, ascending
+		template <typename F>
+		static void for_each_run(std::span<const u64> words, F&& f) noexcept {
+
+			size_t run_first = 0;
+			size_t run_count = 0;
+
+			for (size_t w = 0; w < words.size(); ++w) {
+				for (u64 bits = words[w]; bits != 0;) {
+					const size_t start  = std::countr_zero(bits);
+					const size_t length = std::countr_one(bits >> start);
+
+					bits = start + length == 64 ? 0 : bits & (~u64{ 0 } << (start + length));
+
+					const size_t first = w * 64 + start;
+
+					// runs crossing a word boundary are merged
+					if (run_count != 0 && run_first + run_count == first) {
+						run_count += length;
+						continue;
+					}
+
+					if (run_count != 0) {
+						std::invoke(f, run_first, run_count);
+					}
+
+					run_first = first;
+					run_count = length;
+				}
+			}
+
+			if (run_count != 0) {
+				std::invoke(f, run_first, run_count);
+			}
 		}
 	};
 
+	// values in a raw buffer, occupancy in a bitmask, see `gef::bitset_storage`
+	template <typename T>
+	using packed_sparse_array = sparse_array<T, bitset_storage<T>>;
+
+	// values in fixed-size pages, references stay valid when the array grows, see `gef::paged_storage`
+	template <typename T, size_t PageSize = 4096>
+	using paged_sparse_array = sparse_array<T, paged_storage<T, PageSize>>;
+
+	// `std::pmr` allocated, e.g. from a `gef::arena`
+	namespace pmr {
+		template <typename T>
+		using sparse_array = gef::sparse_array<T, option_storage<T, std::pmr::polymorphic_allocator<T>>>;
+
+		template <typename T>
+		using packed_sparse_array = gef::sparse_array<T, bitset_storage<T, std::pmr::polymorphic_allocator<T>>>;
+
+		template <typename T, size_t PageSize = 4096>
+		using paged_sparse_array = gef::sparse_array<T, paged_storage<T, PageSize, std::pmr::polymorphic_allocator<T>>>;
+	}
 }
\ No newline at end of file
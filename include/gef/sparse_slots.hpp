@@ -0,0 +1,542 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <functional>
+#include <concepts>
+#include <limits>
+#include <cassert>
+
+#include "better_types.hpp"
+#include "option.hpp"
+#include "parallel.hpp"
+#include "sparse_storage.hpp"
+
+namespace gef {
+
+	// Slot index + generation, packed into a u64.
+	// Goes stale once its slot is erased, even if the slot is reused afterwards
+	struct sparse_handle {
+		u64 bits;
+
+		constexpr sparse_handle(const u32 index, const u32 generation) noexcept :
+			bits((static_cast<u64>(generation) << 32) | index) {}
+
+		constexpr u32 index() const noexcept { return static_cast<u32>(bits); }
+
+		constexpr u32 generation() const noexcept { return static_cast<u32>(bits >> 32); }
+
+		constexpr bool operator==(const sparse_handle&) const noexcept = default;
+	};
+
+	// What happened to a slot since the last `clear_dirty`, see `basic_sparse_slots::track_changes`
+	enum class sparse_change : u8 {
+		// empty then, alive now
+		added,
+		// alive then, empty now
+		removed,
+		// alive then and now, but erased in between: a different value lives there
+		replaced,
+		// the same value, changed through `modify` / `mark_modified`
+		modified
+	};
+
+	// Index bookkeeping shared by the sparse containers (`gef::sparse_array`, `gef::soa_sparse_array`).
+	// Tracks which slots are alive, but owns no values: the containers reset their values next to the `*_slot(s)` calls
+	//
+	// Iteration order over `alive_vec` is unspecified (unstable):
+	// `erase_slot` moves the last alive index into the erased position,
+	// `erase_slots_if` keeps the relative order of the remaining indices.
+	// `sort_alive` (or `sorted_iteration`) restores ascending slot order
+	//
+	// `Allocator` is an allocator of `size_t`, used by every bookkeeping vector
+	template <typename Allocator = std::allocator<size_t>>
+	class basic_sparse_slots {
+	public:
+
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		using index_vector = std::vector<size_t, Allocator>;
+
+		index_vector alive_vec;
+
+		// slot -> position in `alive_vec`, `npos` for empty slots
+		index_vector alive_pos;
+
+		// stack of slots that were empty when pushed. entries are validated lazily when popped,
+		// so a slot filled through `emplace_at` may still be listed here
+		index_vector free_vec;
+
+		// bumped every time a slot is erased, see `gef::sparse_handle`
+		std::vector<u32, rebind_alloc<Allocator, u32>> generation_vec;
+
+		// when set, the containers `sort_alive` before iterating
+		bool sorted_iteration{ false };
+
+		// when set, every insert / erase / `mark_modified` is recorded until `clear_dirty`,
+		// so the changes can be walked in O(changed) instead of O(capacity).
+		// writes through `at` / `operator[]` are not seen, use `modify`
+		bool track_changes{ false };
+
+		// slots recorded since `clear_dirty`, each once
+		index_vector dirty_vec;
+
+	public:
+
+		constexpr basic_sparse_slots() noexcept = default;
+
+		constexpr explicit basic_sparse_slots(const Allocator& alloc) noexcept :
+			alive_vec(alloc),
+			alive_pos(alloc),
+			free_vec(alloc),
+			generation_vec(alloc),
+			dirty_vec(alloc),
+			m_dirty_state(alloc)
+		{}
+
+		// amortized O(1). the most recently freed slot is returned first, not necessarily the lowest one
+		constexpr gef::option<size_t> next_empty_index() noexcept {
+
+			while (!free_vec.empty()) {
+				const size_t index = free_vec.back();
+
+				if (index < capacity() && !contains(index)) {
+					return index;
+				}
+
+				// stale entry: filled through `emplace_at`, or cut off by a shrinking resize
+				free_vec.pop_back();
+			}
+
+			return gef::nullopt;
+		}
+
+		constexpr bool contains(const size_t index) const noexcept {
+			return index < alive_pos.size() && alive_pos[index] != npos;
+		}
+
+		// ==== ordering
+
+		// true if `alive_vec` is in ascending slot order
+		constexpr bool is_alive_sorted() const noexcept {
+			return m_alive_sorted;
+		}
+
+		// puts `alive_vec` in ascending slot order, so iteration walks the values sequentially.
+		// free when nothing broke the order since the last call
+		constexpr void sort_alive() noexcept {
+
+			if (m_alive_sorted) {
+				return;
+			}
+
+			// dense: collecting the alive slots in order is cheaper than sorting
+			if (size() >= capacity() / 16) {
+				alive_vec.clear();
+
+				for (size_t index = 0; index < capacity(); ++index) {
+					if (alive_pos[index] != npos) {
+						alive_vec.emplace_back(index);
+					}
+				}
+			}
+			else {
+				std::sort(alive_vec.begin(), alive_vec.end());
+			}
+
+			for (size_t pos = 0; pos < size(); ++pos) {
+				alive_pos[alive_vec[pos]] = pos;
+			}
+
+			m_alive_sorted = true;
+		}
+
+		// ==== generational handles
+
+		// handle to the value currently at `index`. handles index with a u32, slots past it have none
+		constexpr sparse_handle handle_of(const size_t index) const noexcept {
+			assert(index <= std::numeric_limits<u32>::max());
+
+			return sparse_handle{ static_cast<u32>(index), generation_vec[index] };
+		}
+
+		constexpr bool contains(const sparse_handle handle) const noexcept {
+			return contains(handle.index()) && generation_vec[handle.index()] == handle.generation();
+		}
+
+		// ==== change tracking
+
+		// records a change of the value at `index` (no-op unless `track_changes`)
+		constexpr void mark_modified(const size_t index) noexcept {
+			record_change(index, false);
+		}
+
+		constexpr bool is_dirty(const size_t index) const noexcept {
+			return index < m_dirty_state.size() && m_dirty_state[index] != 0;
+		}
+
+		// `f(index, sparse_change)` for every slot recorded since `clear_dirty`, in the order they were first touched.
+		// slots filled and emptied again in between are skipped
+		template <typename F>
+			requires(requires(F& f, size_t i, sparse_change c) { { f(i, c) } -> std::same_as<void>; })
+		constexpr void for_each_dirty(F&& f) const noexcept {
+
+			for (const size_t index : dirty_vec) {
+				const u8 state = m_dirty_state[index];
+
+				const bool was_alive = state & dirty_was_alive;
+				const bool alive     = contains(index);
+
+				if (was_alive && alive) {
+					std::invoke(f, index, (state & dirty_erased) ? sparse_change::replaced : sparse_change::modified);
+				}
+				else if (was_alive) {
+					std::invoke(f, index, sparse_change::removed);
+				}
+				else if (alive) {
+					std::invoke(f, index, sparse_change::added);
+				}
+			}
+		}
+
+		// slots holding a new value (`added` or `replaced`)
+		template <typename F>
+			requires(requires(F& f, size_t i) { { f(i) } -> std::same_as<void>; })
+		constexpr void for_each_added(F&& f) const noexcept {
+			for_each_dirty([&](const size_t index, const sparse_change change) {
+				if (change == sparse_change::added || change == sparse_change::replaced) {
+					std::invoke(f, index);
+				}
+			});
+		}
+
+		// slots whose previous value is gone (`removed` or `replaced`)
+		template <typename F>
+			requires(requires(F& f, size_t i) { { f(i) } -> std::same_as<void>; })
+		constexpr void for_each_removed(F&& f) const noexcept {
+			for_each_dirty([&](const size_t index, const sparse_change change) {
+				if (change == sparse_change::removed || change == sparse_change::replaced) {
+					std::invoke(f, index);
+				}
+			});
+		}
+
+		// O(changed)
+		constexpr void clear_dirty() noexcept {
+
+			for (const size_t index : dirty_vec) {
+				m_dirty_state[index] = 0;
+			}
+
+			dirty_vec.clear();
+		}
+
+		// ====
+
+		// hands contiguous chunks of `alive_vec` to `f`, from several threads at once. sorted first when `sorted_iteration`
+		// is set, like `for_each`. chunks hold `grain` indices rounded up to whole cache lines (see `cache_line_grain`),
+		// they only start on a line boundary when the allocator line aligns `alive_vec`
+		template <typename F>
+			requires(requires(F& f, std::span<const size_t> chunk) { { f(chunk) } -> std::same_as<void>; })
+		void parallel_for_each_chunk(F&& f, const size_t grain = 4096) noexcept {
+
+			prepare_iteration();
+
+			parallel_for_chunks(size(), cache_line_grain<size_t>(grain),
+				[&](const size_t begin, const size_t end) {
+					std::invoke(f, std::span<const size_t>{ alive_vec.data() + begin, end - begin });
+				});
+		}
+
+		constexpr size_t capacity() const noexcept {
+			return alive_pos.size();
+		}
+
+		constexpr size_t size() const noexcept {
+			return alive_vec.size();
+		}
+
+	protected:
+
+		// the containers resize their storage first, which destroys the values of the slots cut off by shrinking
+		constexpr void resize_slots(const size_t new_capacity) noexcept {
+			const size_t old_capacity = capacity();
+
+			if (new_capacity < old_capacity) {
+				erase_slots_if([&](const size_t index) { return index >= new_capacity; });
+			}
+
+			alive_vec.reserve(new_capacity);
+			alive_pos.resize(new_capacity, npos);
+
+			// never shrunk: a slot cut off and grown back keeps counting, so old handles to it stay stale
+			if (generation_vec.size() < new_capacity) {
+				generation_vec.resize(new_capacity, 0);
+			}
+
+			// pushed in reverse, so the lowest new slot is handed out first
+			for (size_t index = new_capacity; index > old_capacity; --index) {
+				free_vec.emplace_back(index - 1);
+			}
+		}
+
+		// `next_empty_index`, taken off the free stack
+		constexpr gef::option<size_t> take_empty_index() noexcept {
+
+			gef::option<size_t> index = next_empty_index();
+
+			if (index.has_value()) {
+				free_vec.pop_back();
+			}
+
+			return index;
+		}
+
+		// false if `index` was already alive, its value is then overwritten and recorded as `replaced`
+		constexpr bool insert_slot(const size_t index) noexcept {
+
+			if (alive_pos[index] != npos) {
+				record_change(index, true);
+
+				return false;
+			}
+
+			record_change(index, false);
+
+			m_alive_sorted = m_alive_sorted && (alive_vec.empty() || alive_vec.back() < index);
+
+			alive_pos[index] = alive_vec.size();
+			alive_vec.emplace_back(index);
+
+			return true;
+		}
+
+		// O(1), swaps the last alive index into the erased position. false if `index` was already empty
+		constexpr bool erase_slot(const size_t index) noexcept {
+
+			const size_t pos = alive_pos[index];
+
+			if (pos == npos) {
+				return false;
+			}
+
+			record_change(index, true);
+
+			const size_t last = alive_vec.back();
+
+			m_alive_sorted = m_alive_sorted && last == index;
+
+			alive_vec[pos]  = last;
+			alive_pos[last] = pos;
+
+			alive_vec.pop_back();
+			alive_pos[index] = npos;
+
+			release_slot(index);
+
+			return true;
+		}
+
+		// single pass, erases every alive index `f` returns true for
+		template <typename F>
+			requires(requires(F&& f, size_t i) { { f(i) } -> std::same_as<bool>; })
+		constexpr void erase_slots_if(F&& f) noexcept {
+
+			size_t kept = 0;
+
+			for (const size_t index : alive_vec) {
+				if (std::invoke(f, index)) {
+					record_change(index, true);
+
+					alive_pos[index] = npos;
+
+					release_slot(index);
+				}
+				else {
+					alive_pos[index] = kept;
+					alive_vec[kept++] = index;
+				}
+			}
+
+			alive_vec.resize(kept);
+		}
+
+		// erases every alive index of `indices`, calling `on_erase(index)` first. empty slots and duplicates are skipped.
+		// small batches swap-pop, large ones invalidate first and compact `alive_vec` in one pass, keeping its order.
+		// returns how many were erased
+		template <typename F>
+			requires(requires(F&& f, size_t i) { { f(i) } -> std::same_as<void>; })
+		constexpr size_t erase_slots(std::span<const size_t> indices, F&& on_erase) noexcept {
+
+			size_t erased = 0;
+
+			if (indices.size() < size() / 8) {
+				for (const size_t index : indices) {
+					if (contains(index)) {
+						std::invoke(on_erase, index);
+
+						erase_slot(index);
+						++erased;
+					}
+				}
+
+				return erased;
+			}
+
+			for (const size_t index : indices) {
+				if (contains(index)) {
+					std::invoke(on_erase, index);
+
+					record_change(index, true);
+
+					alive_pos[index] = npos;
+
+					release_slot(index);
+					++erased;
+				}
+			}
+
+			if (erased == 0) {
+				return 0;
+			}
+
+			size_t kept = 0;
+
+			for (const size_t index : alive_vec) {
+				if (alive_pos[index] != npos) {
+					alive_pos[index] = kept;
+					alive_vec[kept++] = index;
+				}
+			}
+
+			alive_vec.resize(kept);
+
+			return erased;
+		}
+
+		constexpr void clear_slots() noexcept {
+
+			for (const size_t index : alive_vec) {
+				record_change(index, true);
+
+				alive_pos[index] = npos;
+
+				release_slot(index);
+			}
+
+			alive_vec.clear();
+
+			m_alive_sorted = true;
+		}
+
+		// call before iterating `alive_vec`
+		constexpr void prepare_iteration() noexcept {
+			if (sorted_iteration) {
+				sort_alive();
+			}
+		}
+
+		// moves every alive value down to [0, size()), keeping their order by slot.
+		// `move(from, to)` must move the value and reset `from`. `to` is always empty (or already moved out) when called.
+		// returns old slot -> new slot, `npos` for slots that were empty.
+		// generations of moved slots are bumped, so their handles go stale
+		template <typename F>
+			requires(requires(F&& f, size_t from, size_t to) { { f(from, to) } -> std::same_as<void>; })
+		constexpr index_vector compact_slots(F&& move) noexcept {
+
+			sort_alive();
+
+			index_vector remap(capacity(), npos, alive_vec.get_allocator());
+
+			for (size_t pos = 0; pos < size(); ++pos) {
+				const size_t index = alive_vec[pos];
+
+				remap[index] = pos;
+
+				if (index != pos) {
+					// the value leaves `index` and shows up at `pos`
+					record_change(index, true);
+					record_change(pos, false);
+
+					std::invoke(move, index, pos);
+
+					++generation_vec[index];
+
+					alive_pos[index] = npos;
+					alive_pos[pos]   = pos;
+					alive_vec[pos]   = pos;
+				}
+			}
+
+			rebuild_free_list();
+
+			return remap;
+		}
+
+		// every empty slot, the lowest on top
+		constexpr void rebuild_free_list() noexcept {
+			free_vec.clear();
+
+			for (size_t index = capacity(); index > 0; --index) {
+				if (!contains(index - 1)) {
+					free_vec.emplace_back(index - 1);
+				}
+			}
+		}
+
+	private:
+
+		static constexpr u8 dirty_listed    = 1;
+		static constexpr u8 dirty_was_alive = 2;
+		static constexpr u8 dirty_erased    = 4;
+
+		// call before the slot changes: the first record of a slot remembers whether it was alive
+		constexpr void record_change(const size_t index, const bool erasing) noexcept {
+
+			if (!track_changes) {
+				return;
+			}
+
+			if (m_dirty_state.size() <= index) {
+				m_dirty_state.resize(capacity(), 0);
+			}
+
+			u8& state = m_dirty_state[index];
+
+			if (state == 0) {
+				state = dirty_listed | (contains(index) ? dirty_was_alive : 0);
+
+				dirty_vec.emplace_back(index);
+			}
+
+			if (erasing) {
+				state |= dirty_erased;
+			}
+		}
+
+		constexpr void release_slot(const size_t index) noexcept {
+			++generation_vec[index];
+
+			push_free(index);
+		}
+
+		constexpr void push_free(const size_t index) noexcept {
+			free_vec.emplace_back(index);
+
+			// only duplicates can push the stack past the slot count, drop them
+			if (free_vec.size() > capacity()) {
+				rebuild_free_list();
+			}
+		}
+
+
+	private:
+		bool m_alive_sorted{ true };
+
+		// `dirty_*` flags per slot, grown on demand
+		std::vector<u8, rebind_alloc<Allocator, u8>> m_dirty_state;
+	};
+
+	using sparse_slots = basic_sparse_slots<>;
+}
\ No newline at end of file
@@ -0,0 +1,556 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <bit>
+#include <utility>
+#include <cstring>
+#include <concepts>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+#include "better_types.hpp"
+#include "option.hpp"
+
+namespace gef {
+
+	template <typename Allocator, typename U>
+	using rebind_alloc = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+	// Slot storages for `gef::sparse_array`.
+	// A storage only owns the values, the index bookkeeping lives in the container.
+	// Same vocabulary as `gef::option`: `set`, `reset`, `has_value`, `value_unchecked`,
+	// plus `construct`, a `set` for slots known to be empty
+	//
+	// `Allocator` is an allocator of `T`, rebound internally. it is not propagated on assignment
+
+	// One `gef::option<T>` per slot
+	template <typename T, typename Allocator = std::allocator<T>>
+	class option_storage {
+	public:
+
+		using allocator_type = Allocator;
+
+		constexpr option_storage() noexcept = default;
+
+		constexpr explicit option_storage(const Allocator& alloc) noexcept :
+			m_slots(alloc) {}
+
+		constexpr void resize(const size_t new_size) noexcept {
+			m_slots.resize(new_size);
+		}
+
+		constexpr size_t size() const noexcept {
+			return m_slots.size();
+		}
+
+		constexpr bool has_value(const size_t index) const noexcept {
+			return m_slots[index].has_value();
+		}
+
+		constexpr auto& value_unchecked(this auto& self, const size_t index) noexcept {
+			return self.m_slots[index].value_unchecked();
+		}
+
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr T& set(const size_t index, Args&&... args) noexcept {
+			return m_slots[index].set(std::forward<Args>(args)...);
+		}
+
+		// the empty check of `set` is only a flag test here
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr T& construct(const size_t index, Args&&... args) noexcept {
+			return m_slots[index].set(std::forward<Args>(args)...);
+		}
+
+		constexpr void reset(const size_t index) noexcept {
+			m_slots[index].reset();
+		}
+
+	private:
+		std::vector<gef::option<T>, rebind_alloc<Allocator, gef::option<T>>> m_slots;
+	};
+
+	// Values in one raw buffer, occupancy in a separate bitmask (1 bit per slot)
+	template <typename T, typename Allocator = std::allocator<T>>
+	class bitset_storage {
+	public:
+
+		using allocator_type = Allocator;
+
+		static constexpr size_t word_bits = 64;
+
+		constexpr bitset_storage() noexcept = default;
+
+		constexpr explicit bitset_storage(const Allocator& alloc) noexcept :
+			m_alloc(alloc),
+			m_mask(alloc)
+		{}
+
+		constexpr bitset_storage(bitset_storage const& other) noexcept :
+			m_alloc(alloc_traits::select_on_container_copy_construction(other.m_alloc)),
+			m_mask(other.m_mask, m_alloc)
+		{
+			copy_values(other);
+		}
+
+		constexpr bitset_storage(bitset_storage&& other) noexcept :
+			m_alloc(std::move(other.m_alloc)),
+			m_values(std::exchange(other.m_values, nullptr)),
+			m_mask(std::move(other.m_mask)),
+			m_size(std::exchange(other.m_size, 0))
+		{}
+
+		constexpr bitset_storage& operator=(bitset_storage const& other) noexcept {
+			if (this != &other) {
+				release();
+
+				m_mask = other.m_mask;
+
+				copy_values(other);
+			}
+
+			return *this;
+		}
+
+		constexpr bitset_storage& operator=(bitset_storage&& other) noexcept {
+			if (this == &other) {
+				return *this;
+			}
+
+			release();
+
+			// memory from another allocator can't be adopted, move the values one by one
+			if (m_alloc == other.m_alloc) {
+				m_mask   = std::move(other.m_mask);
+				m_values = std::exchange(other.m_values, nullptr);
+				m_size   = std::exchange(other.m_size, 0);
+			}
+			else {
+				m_mask   = other.m_mask;
+				m_size   = other.m_size;
+				m_values = allocate(m_size);
+
+				for_each_set([&](const size_t index) {
+					new (m_values + index) T(std::move(other.m_values[index]));
+				});
+
+				other.release();
+				other.m_mask.clear();
+				other.m_size = 0;
+			}
+
+			return *this;
+		}
+
+		constexpr ~bitset_storage() noexcept {
+			release();
+		}
+
+		// ====
+
+		constexpr void resize(const size_t new_size) noexcept {
+
+			if (new_size == m_size) {
+				return;
+			}
+
+			T* new_values = allocate(new_size);
+
+			for_each_set([&](const size_t index) {
+				if (index < new_size) {
+					new (new_values + index) T(std::move(m_values[index]));
+				}
+			});
+
+			release();
+
+			m_values = new_values;
+			m_size   = new_size;
+
+			// drop the bits of slots cut off by shrinking
+			m_mask.resize(word_count(new_size), 0);
+
+			if (const size_t tail = new_size % word_bits; tail != 0) {
+				m_mask.back() &= (u64{ 1 } << tail) - 1;
+			}
+		}
+
+		constexpr size_t size() const noexcept {
+			return m_size;
+		}
+
+		constexpr bool has_value(const size_t index) const noexcept {
+			return (m_mask[index / word_bits] >> (index % word_bits)) & 1;
+		}
+
+		constexpr auto& value_unchecked(this auto& self, const size_t index) noexcept {
+			return self.m_values[index];
+		}
+
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr T& set(const size_t index, Args&&... args) noexcept {
+			reset(index);
+
+			m_mask[index / word_bits] |= u64{ 1 } << (index % word_bits);
+
+			return *new (m_values + index) T(std::forward<Args>(args)...);
+		}
+
+		// `set` without destroying a previous value, the slot must be empty
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr T& construct(const size_t index, Args&&... args) noexcept {
+			m_mask[index / word_bits] |= u64{ 1 } << (index % word_bits);
+
+			return *new (m_values + index) T(std::forward<Args>(args)...);
+		}
+
+		// fills the empty slots [first, first + count) with a copy of the bytes at `src`
+		constexpr void construct_run(const size_t first, const size_t count, const void* src) noexcept
+			requires(std::is_trivially_copyable_v<T>)
+		{
+			std::memcpy(static_cast<void*>(m_values + first), src, count * sizeof(T));
+
+			for (size_t index = first; index < first + count; ++index) {
+				m_mask[index / word_bits] |= u64{ 1 } << (index % word_bits);
+			}
+		}
+
+		constexpr void reset(const size_t index) noexcept {
+			if (has_value(index)) {
+				m_values[index].~T();
+				m_mask[index / word_bits] &= ~(u64{ 1 } << (index % word_bits));
+			}
+		}
+
+		// ====
+
+		// occupancy, bit `i % 64` of word `i / 64` is set when slot `i` holds a value
+		constexpr auto const& mask() const noexcept {
+			return m_mask;
+		}
+
+		// like `mask()[w]`, but only the slots whose value also satisfies `pred`.
+		// on a full word `pred` runs on all 64 slots without branching, into one byte per slot, so the compares vectorize
+		// (SSE / AVX2 / NEON, whatever the target allows). empty slots are read too and masked off afterwards.
+		// the last, partial word checks each slot against the size first, the buffer ends there
+		template <typename P>
+			requires(std::is_scalar_v<T> && std::predicate<P&, const T&>)
+		constexpr u64 match_word(const size_t w, P& pred) const noexcept {
+			const T* values = m_values + w * word_bits;
+			const size_t n  = std::min(word_bits, m_size - w * word_bits);
+
+			u8 flags[word_bits];
+
+			if (n == word_bits) {
+				for (size_t b = 0; b < word_bits; ++b) {
+					flags[b] = static_cast<bool>(std::invoke(pred, values[b]));
+				}
+			}
+			else {
+				for (size_t b = 0; b < word_bits; ++b) {
+					flags[b] = b < n && static_cast<bool>(std::invoke(pred, values[b]));
+				}
+			}
+
+			// 8 flag bytes -> 8 bits with one multiply, flag `i` lands in bit 56 + i
+			u64 bits = 0;
+
+			for (size_t g = 0; g < word_bits / 8; ++g) {
+				u64 group;
+
+				std::memcpy(&group, flags + g * 8, 8);
+
+				if constexpr (std::endian::native == std::endian::big) {
+					group = std::byteswap(group);
+				}
+
+				bits |= ((group * 0x0102040810204080) >> 56) << (g * 8);
+			}
+
+			return bits & m_mask[w];
+		}
+
+		template <typename F>
+			requires(requires(F&& f, size_t i) { { f(i) } -> std::same_as<void>; })
+		constexpr void for_each_set(F&& f) const noexcept {
+			for (size_t w = 0; w < m_mask.size(); ++w) {
+				for (u64 bits = m_mask[w]; bits != 0; bits &= bits - 1) {
+					std::invoke(f, w * word_bits + std::countr_zero(bits));
+				}
+			}
+		}
+
+	private:
+
+		using alloc_traits = std::allocator_traits<Allocator>;
+
+		static constexpr size_t word_count(const size_t slots) noexcept {
+			return (slots + word_bits - 1) / word_bits;
+		}
+
+		constexpr T* allocate(const size_t n) noexcept {
+			if (n == 0) {
+				return nullptr;
+			}
+
+			T* values = alloc_traits::allocate(m_alloc, n);
+
+			// `match_word` reads empty slots, give them a value
+			if constexpr (std::is_scalar_v<T>) {
+				std::uninitialized_value_construct_n(values, n);
+			}
+
+			return values;
+		}
+
+		// expects no values, `m_mask` already copied
+		constexpr void copy_values(bitset_storage const& other) noexcept {
+			m_size   = other.m_size;
+			m_values = allocate(m_size);
+
+			for_each_set([&](const size_t index) {
+				new (m_values + index) T(other.m_values[index]);
+			});
+		}
+
+		constexpr void release() noexcept {
+			if (m_values == nullptr) {
+				return;
+			}
+
+			for_each_set([&](const size_t index) {
+				m_values[index].~T();
+			});
+
+			alloc_traits::deallocate(m_alloc, m_values, m_size);
+
+			m_values = nullptr;
+		}
+
+	private:
+		Allocator m_alloc;
+
+		T* m_values{ nullptr };
+		std::vector<u64, rebind_alloc<Allocator, u64>> m_mask;
+		size_t m_size{ 0 };
+	};
+
+	// Values in fixed-size pages of `PageSize` slots, each page with its own occupancy bits.
+	// Growing only appends pages: values never move, references stay valid across `resize`,
+	// and the values cost O(PageSize) per new page instead of O(size).
+	// The container's index bookkeeping (`alive_pos`, generations) is still a plain vector, copied in O(size) integers on growth
+	template <typename T, size_t PageSize = 4096, typename Allocator = std::allocator<T>>
+	class paged_storage {
+		static_assert(PageSize > 0 && PageSize % 64 == 0, "page size must be a multiple of 64 slots");
+
+	public:
+
+		using allocator_type = Allocator;
+
+		static constexpr size_t page_size = PageSize;
+
+		constexpr paged_storage() noexcept = default;
+
+		constexpr explicit paged_storage(const Allocator& alloc) noexcept :
+			m_alloc(alloc),
+			m_pages(alloc)
+		{}
+
+		constexpr paged_storage(paged_storage const& other) noexcept :
+			m_alloc(page_traits::select_on_container_copy_construction(other.m_alloc)),
+			m_pages(m_alloc)
+		{
+			copy_pages(other);
+		}
+
+		constexpr paged_storage(paged_storage&& other) noexcept :
+			m_alloc(std::move(other.m_alloc)),
+			m_pages(std::move(other.m_pages)),
+			m_size(std::exchange(other.m_size, 0))
+		{}
+
+		constexpr paged_storage& operator=(paged_storage const& other) noexcept {
+			if (this != &other) {
+				release();
+				copy_pages(other);
+			}
+
+			return *this;
+		}
+
+		constexpr paged_storage& operator=(paged_storage&& other) noexcept {
+			if (this == &other) {
+				return *this;
+			}
+
+			release();
+
+			// pages from another allocator can't be adopted, copy them over by moving the values
+			if (m_alloc == other.m_alloc) {
+				m_pages = std::move(other.m_pages);
+				m_size  = std::exchange(other.m_size, 0);
+			}
+			else {
+				resize(other.m_size);
+
+				other.for_each_set([&](const size_t index) {
+					construct(index, std::move(other.value_unchecked(index)));
+				});
+
+				other.release();
+			}
+
+			return *this;
+		}
+
+		constexpr ~paged_storage() noexcept {
+			release();
+		}
+
+		// ====
+
+		// appends or frees whole pages, the values of the remaining slots stay in place
+		constexpr void resize(const size_t new_size) noexcept {
+
+			// values cut off by shrinking
+			for (size_t index = new_size; index < m_size; ++index) {
+				reset(index);
+			}
+
+			const size_t pages = (new_size + PageSize - 1) / PageSize;
+
+			while (m_pages.size() > pages) {
+				free_page(m_pages.back());
+				m_pages.pop_back();
+			}
+
+			// the page table grows geometrically, one page at a time would reallocate it every resize
+			while (m_pages.size() < pages) {
+				m_pages.emplace_back(allocate_page());
+			}
+
+			m_size = new_size;
+		}
+
+		constexpr size_t size() const noexcept {
+			return m_size;
+		}
+
+		constexpr bool has_value(const size_t index) const noexcept {
+			const page* p = m_pages[index / PageSize];
+			const size_t offset = index % PageSize;
+
+			return (p->mask[offset / 64] >> (offset % 64)) & 1;
+		}
+
+		constexpr auto& value_unchecked(this auto& self, const size_t index) noexcept {
+			return std::forward_like<decltype(self)>(*self.value_ptr(index));
+		}
+
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr T& set(const size_t index, Args&&... args) noexcept {
+			reset(index);
+
+			return construct(index, std::forward<Args>(args)...);
+		}
+
+		// `set` without destroying a previous value, the slot must be empty
+		template <typename ...Args>
+			requires(std::constructible_from<T, Args...>)
+		constexpr T& construct(const size_t index, Args&&... args) noexcept {
+			page* p = m_pages[index / PageSize];
+			const size_t offset = index % PageSize;
+
+			p->mask[offset / 64] |= u64{ 1 } << (offset % 64);
+
+			return *new (p->values + offset * sizeof(T)) T(std::forward<Args>(args)...);
+		}
+
+		constexpr void reset(const size_t index) noexcept {
+			if (has_value(index)) {
+				page* p = m_pages[index / PageSize];
+				const size_t offset = index % PageSize;
+
+				value_ptr(index)->~T();
+				p->mask[offset / 64] &= ~(u64{ 1 } << (offset % 64));
+			}
+		}
+
+		template <typename F>
+			requires(requires(F&& f, size_t i) { { f(i) } -> std::same_as<void>; })
+		constexpr void for_each_set(F&& f) const noexcept {
+			for (size_t pg = 0; pg < m_pages.size(); ++pg) {
+				for (size_t w = 0; w < PageSize / 64; ++w) {
+					for (u64 bits = m_pages[pg]->mask[w]; bits != 0; bits &= bits - 1) {
+						std::invoke(f, pg * PageSize + w * 64 + std::countr_zero(bits));
+					}
+				}
+			}
+		}
+
+	private:
+
+		struct page {
+			alignas(T) std::byte values[sizeof(T) * PageSize];
+			u64 mask[PageSize / 64];
+		};
+
+		using page_alloc  = rebind_alloc<Allocator, page>;
+		using page_traits = std::allocator_traits<page_alloc>;
+
+		constexpr T* value_ptr(const size_t index) const noexcept {
+			return std::launder(reinterpret_cast<T*>(m_pages[index / PageSize]->values + (index % PageSize) * sizeof(T)));
+		}
+
+		// values left uninitialized, only the mask is cleared
+		constexpr page* allocate_page() noexcept {
+			page* p = new (page_traits::allocate(m_alloc, 1)) page;
+
+			std::fill(std::begin(p->mask), std::end(p->mask), 0);
+
+			return p;
+		}
+
+		constexpr void free_page(page* p) noexcept {
+			p->~page();
+			page_traits::deallocate(m_alloc, p, 1);
+		}
+
+		// expects no pages
+		constexpr void copy_pages(paged_storage const& other) noexcept {
+			resize(other.m_size);
+
+			other.for_each_set([&](const size_t index) {
+				construct(index, other.value_unchecked(index));
+			});
+		}
+
+		constexpr void release() noexcept {
+			for_each_set([&](const size_t index) {
+				value_ptr(index)->~T();
+			});
+
+			for (page* p : m_pages) {
+				free_page(p);
+			}
+
+			m_pages.clear();
+			m_size = 0;
+		}
+
+	private:
+		page_alloc m_alloc;
+
+		std::vector<page*, rebind_alloc<Allocator, page*>> m_pages;
+		size_t m_size{ 0 };
+	};
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <type_traits>
+#include <concepts>
 
 namespace gef {
 
@@ -12,7 +13,8 @@ namespace gef {
 	static constexpr maybe_nullref_t maybe_nullref{};
 
 	// Just like std::unique_ptr, but cannot be null (except after moved, but it is not a valid state)
-	template <class T> class unique_ref {
+	// `Deleter` lets allocators other than new/delete hand out owners, see `gef::pool`
+	template <class T, class Deleter = std::default_delete<T>> class unique_ref {
 	public:
 
 		constexpr unique_ref(unique_ref&)           = delete;
@@ -24,7 +26,7 @@ namespace gef {
 		constexpr unique_ref(std::nullptr_t) noexcept : _Ptr(nullptr) {}
 
 		// Explicitly state that the unique_ptr may be null
-		constexpr unique_ref(maybe_nullref_t, std::unique_ptr<T>&& uqptr) noexcept :
+		constexpr unique_ref(maybe_nullref_t, std::unique_ptr<T, Deleter>&& uqptr) noexcept :
 			_Ptr(std::move(uqptr))
 		{}
 
@@ -34,18 +36,23 @@ namespace gef {
 			_Ptr(ptr)
 		{}
 
+		// Takes ownership, `ptr` is released with `deleter`
+		constexpr unique_ref(maybe_nullref_t, T* ptr, Deleter deleter) noexcept :
+			_Ptr(ptr, std::move(deleter))
+		{}
+
 		template <typename ...Args>
-			requires(std::constructible_from<T, Args...>)
+			requires(std::constructible_from<T, Args...> && std::same_as<Deleter, std::default_delete<T>>)
 		constexpr unique_ref(std::in_place_t, Args&&... args) noexcept :
 			_Ptr(std::make_unique<T>(std::forward<Args>(args)...)) {}
 
-		template <typename U>
-			requires(std::derived_from<U, T>)
-		constexpr unique_ref(unique_ref<U>&& u) noexcept :
+		template <typename U, typename D>
+			requires(std::derived_from<U, T> && std::convertible_to<D, Deleter>)
+		constexpr unique_ref(unique_ref<U, D>&& u) noexcept :
 			_Ptr(std::move(u._Ptr)) {}
 
 		template <typename ...Args>
-			requires(std::constructible_from<T, Args...>)
+			requires(std::constructible_from<T, Args...> && std::same_as<Deleter, std::default_delete<T>>)
 		static unique_ref make(Args&&... args) noexcept {
 			return unique_ref{ std::in_place, std::forward<Args>(args)... };
 		}
@@ -60,7 +67,7 @@ namespace gef {
 		}
 
 		constexpr void swap(unique_ref& rhs) noexcept {
-			_Ptr.swap(rhs.storage());
+			_Ptr.swap(rhs._Ptr);
 		}
 
 		constexpr auto operator->(this auto& self) noexcept {
@@ -68,6 +75,6 @@ namespace gef {
 		}
 
 	public:
-		std::unique_ptr<T> _Ptr;
+		std::unique_ptr<T, Deleter> _Ptr;
 	};
 }
\ No newline at end of file